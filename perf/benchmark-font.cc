@@ -1,5 +1,6 @@
 #include "benchmark/benchmark.h"
 #include <cassert>
+#include <cmath>
 #include <cstring>
 
 #ifdef HAVE_CONFIG_H
@@ -30,6 +31,16 @@ struct test_input_t
   {false, SUBSET_FONT_BASE_PATH "NotoSerifMyanmar-Regular.otf"},
 };
 
+struct run_input_t
+{
+  const char *font_path;
+  const char *text_path; /* If null, a CJK run is synthesized from the font's cmap. */
+} run_tests[] =
+{
+  {SUBSET_FONT_BASE_PATH "Roboto-Regular.ttf", "perf/texts/en-thelittleprince.txt"},
+  {SUBSET_FONT_BASE_PATH "Mplus1p-Regular.ttf", nullptr},
+};
+
 static test_input_t *tests = default_tests;
 static unsigned num_tests = sizeof (default_tests) / sizeof (default_tests[0]);
 
@@ -173,6 +184,132 @@ static void BM_Font (benchmark::State &state,
   hb_font_destroy (font);
 }
 
+static unsigned
+_load_run (const run_input_t &input, hb_face_t *face, hb_codepoint_t **unicodes)
+{
+  hb_buffer_t *buffer = hb_buffer_create ();
+
+  if (input.text_path)
+  {
+    hb_blob_t *blob = hb_blob_create_from_file_or_fail (input.text_path);
+    assert (blob);
+    unsigned len;
+    const char *text = hb_blob_get_data (blob, &len);
+    hb_buffer_add_utf8 (buffer, text, len, 0, len);
+    hb_blob_destroy (blob);
+  }
+  else
+  {
+    /* Pick characters with a Zipf-like (log-uniform) distribution,
+     * to roughly mimic the character frequencies of real text. */
+    hb_set_t *set = hb_set_create ();
+    hb_face_collect_unicodes (face, set);
+    hb_set_del_range (set, 0, 0x2FFFu);
+    unsigned pop = hb_set_get_population (set);
+    assert (pop);
+    hb_codepoint_t *cjk = (hb_codepoint_t *) calloc (pop, sizeof (hb_codepoint_t));
+    hb_codepoint_t *p = cjk;
+    for (hb_codepoint_t u = HB_SET_VALUE_INVALID;
+	 hb_set_next (set, &u);)
+      *p++ = u;
+
+    unsigned seed = 1;
+    for (unsigned i = 0; i < 100000; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      double r = (double) ((seed >> 8) & 0xFFFF) / 0x10000;
+      hb_buffer_add (buffer, cjk[(unsigned) pow (pop, r) - 1], i);
+    }
+
+    free (cjk);
+    hb_set_destroy (set);
+  }
+
+  unsigned count = hb_buffer_get_length (buffer);
+  hb_glyph_info_t *infos = hb_buffer_get_glyph_infos (buffer, nullptr);
+  *unicodes = (hb_codepoint_t *) calloc (count, sizeof (hb_codepoint_t));
+  for (unsigned i = 0; i < count; i++)
+    (*unicodes)[i] = infos[i].codepoint;
+
+  hb_buffer_destroy (buffer);
+  return count;
+}
+
+static void BM_FontRun (benchmark::State &state,
+			backend_t backend,
+			const run_input_t &input)
+{
+  hb_font_t *font;
+  hb_codepoint_t *unicodes;
+  unsigned count;
+  {
+    hb_blob_t *blob = hb_blob_create_from_file_or_fail (input.font_path);
+    assert (blob);
+    hb_face_t *face = hb_face_create (blob, 0);
+    hb_blob_destroy (blob);
+    count = _load_run (input, face, &unicodes);
+    font = hb_font_create (face);
+    hb_face_destroy (face);
+  }
+
+  switch (backend)
+  {
+    case HARFBUZZ:
+      hb_ot_font_set_funcs (font);
+      break;
+
+    case FREETYPE:
+#ifdef HAVE_FREETYPE
+      hb_ft_font_set_funcs (font);
+#endif
+      break;
+  }
+
+  hb_codepoint_t *glyphs = (hb_codepoint_t *) calloc (count, sizeof (hb_codepoint_t));
+
+  /* Shapers stop at the first unmapped character and retry one by one
+   * from there; do the same. */
+  for (auto _ : state)
+    for (unsigned done = 0; done < count;)
+    {
+      done += hb_font_get_nominal_glyphs (font,
+					  count - done,
+					  unicodes + done, sizeof (*unicodes),
+					  glyphs + done, sizeof (*glyphs));
+      if (done < count)
+      {
+	hb_font_get_nominal_glyph (font, unicodes[done], glyphs + done);
+	done++;
+      }
+    }
+
+  free (glyphs);
+  free (unicodes);
+  hb_font_destroy (font);
+}
+
+static void test_run_backend (backend_t backend,
+			      const char *backend_name,
+			      const run_input_t &input)
+{
+  char name[1024] = "BM_FontRun/nominal_glyphs/";
+  const char *p = strrchr (input.font_path, '/');
+  strcat (name, p ? p + 1 : input.font_path);
+  strcat (name, "/");
+  if (input.text_path)
+  {
+    p = strrchr (input.text_path, '/');
+    strcat (name, p ? p + 1 : input.text_path);
+  }
+  else
+    strcat (name, "cjk");
+  strcat (name, "/");
+  strcat (name, backend_name);
+
+  benchmark::RegisterBenchmark (name, BM_FontRun, backend, input)
+   ->Unit(benchmark::kMicrosecond);
+}
+
 static void test_backend (backend_t backend,
 			  const char *backend_name,
 			  bool variable,
@@ -237,6 +374,14 @@ int main(int argc, char** argv)
 
 #undef TEST_OPERATION
 
+  for (const auto &input : run_tests)
+  {
+    test_run_backend (HARFBUZZ, "hb", input);
+#ifdef HAVE_FREETYPE
+    test_run_backend (FREETYPE, "ft", input);
+#endif
+  }
+
   benchmark::RunSpecifiedBenchmarks();
   benchmark::Shutdown();
 
@@ -0,0 +1,140 @@
+#include "benchmark/benchmark.h"
+#include <cstring>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "hb.h"
+
+struct test_input_t
+{
+  const char *font_path;
+  const char *text_path;
+} default_tests[] =
+{
+  {"perf/fonts/NotoNastaliqUrdu-Regular.ttf",
+   "perf/texts/fa-thelittleprince.txt"},
+
+  {"perf/fonts/Amiri-Regular.ttf",
+   "perf/texts/fa-thelittleprince.txt"},
+
+  {"perf/fonts/Roboto-Regular.ttf",
+   "perf/texts/en-thelittleprince.txt"},
+};
+
+static test_input_t *tests = default_tests;
+static unsigned num_tests = sizeof (default_tests) / sizeof (default_tests[0]);
+
+/* Runs the tasks on num_threads threads, one of them the calling one. */
+static void
+thread_executor (unsigned int          num_tasks,
+		 hb_shape_task_func_t  task,
+		 void                 *task_data,
+		 void                 *user_data)
+{
+  unsigned num_threads = *(unsigned *) user_data;
+  std::atomic<unsigned> next {0};
+  auto worker = [&] ()
+  {
+    unsigned i;
+    while ((i = next++) < num_tasks)
+      task (i, task_data);
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < num_threads; t++)
+    threads.emplace_back (worker);
+  worker ();
+  for (auto &thread : threads)
+    thread.join ();
+}
+
+/* Shapes the whole text as one paragraph, with state.range(0) threads;
+ * zero threads shapes with hb_shape() instead. */
+static void BM_ShapeParallel (benchmark::State &state,
+			      const test_input_t &input)
+{
+  hb_font_t *font;
+  {
+    hb_blob_t *blob = hb_blob_create_from_file_or_fail (input.font_path);
+    assert (blob);
+    hb_face_t *face = hb_face_create (blob, 0);
+    hb_blob_destroy (blob);
+    font = hb_font_create (face);
+    hb_face_destroy (face);
+  }
+  hb_font_freeze (font);
+
+  hb_blob_t *text_blob = hb_blob_create_from_file_or_fail (input.text_path);
+  assert (text_blob);
+  unsigned text_length;
+  const char *text = hb_blob_get_data (text_blob, &text_length);
+
+  unsigned num_threads = state.range (0);
+  hb_buffer_t *buf = hb_buffer_create ();
+  for (auto _ : state)
+  {
+    hb_buffer_clear_contents (buf);
+    hb_buffer_add_utf8 (buf, text, text_length, 0, text_length);
+    hb_buffer_guess_segment_properties (buf);
+    if (num_threads)
+      hb_shape_parallel (font, buf, nullptr, 0, nullptr, thread_executor, &num_threads);
+    else
+      hb_shape (font, buf, nullptr, 0);
+  }
+  hb_buffer_destroy (buf);
+
+  hb_blob_destroy (text_blob);
+  hb_font_destroy (font);
+}
+
+static void test_input (const test_input_t &test_input)
+{
+  char name[1024] = "BM_ShapeParallel";
+  const char *p;
+  strcat (name, "/");
+  p = strrchr (test_input.font_path, '/');
+  strcat (name, p ? p + 1 : test_input.font_path);
+  strcat (name, "/");
+  p = strrchr (test_input.text_path, '/');
+  strcat (name, p ? p + 1 : test_input.text_path);
+
+  unsigned max_threads = std::thread::hardware_concurrency ();
+  auto *bm = benchmark::RegisterBenchmark (name, BM_ShapeParallel, test_input)
+	     ->Unit(benchmark::kMillisecond)
+	     ->UseRealTime()
+	     ->Arg(0);
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    bm->Arg(threads);
+}
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  if (argc > 2)
+  {
+    num_tests = (argc - 1) / 2;
+    tests = (test_input_t *) calloc (num_tests, sizeof (test_input_t));
+    for (unsigned i = 0; i < num_tests; i++)
+    {
+      tests[i].font_path = argv[1 + i * 2];
+      tests[i].text_path = argv[2 + i * 2];
+    }
+  }
+
+  for (unsigned i = 0; i < num_tests; i++)
+    test_input (tests[i]);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  if (tests != default_tests)
+    free (tests);
+}
@@ -6,6 +6,7 @@
 #endif
 
 #include <cassert>
+#include <vector>
 
 #include "hb.h"
 #include "hb-ot.h"
@@ -113,6 +114,114 @@ static void BM_Shape (benchmark::State &state,
   hb_font_destroy (font);
 }
 
+/* Shapes each line as its own run, from buffers made beforehand;
+ * state.range(0) says whether one at a time or with hb_shape_batch(). */
+static void BM_ShapeBatch (benchmark::State &state,
+			   const test_input_t &input)
+{
+  hb_font_t *font;
+  {
+    hb_blob_t *blob = hb_blob_create_from_file_or_fail (input.font_path);
+    assert (blob);
+    hb_face_t *face = hb_face_create (blob, 0);
+    hb_blob_destroy (blob);
+    font = hb_font_create (face);
+    hb_face_destroy (face);
+  }
+
+  hb_blob_t *text_blob = hb_blob_create_from_file_or_fail (input.text_path);
+  assert (text_blob);
+  unsigned text_length;
+  const char *text = hb_blob_get_data (text_blob, &text_length);
+
+  std::vector<hb_buffer_t *> runs;
+  const char *end;
+  while ((end = (const char *) memchr (text, '\n', text_length)))
+  {
+    hb_buffer_t *run = hb_buffer_create ();
+    hb_buffer_add_utf8 (run, text, text_length, 0, end - text);
+    hb_buffer_guess_segment_properties (run);
+    runs.push_back (run);
+
+    unsigned skip = end - text + 1;
+    text_length -= skip;
+    text += skip;
+  }
+
+  bool batch = state.range (0);
+  std::vector<unsigned> offsets (runs.size () + 1);
+  hb_buffer_t *buf = hb_buffer_create ();
+  for (auto _ : state)
+  {
+    if (batch)
+      hb_shape_batch (font, runs.data (), runs.size (), nullptr, 0, nullptr,
+		      buf, offsets.data ());
+    else
+      for (hb_buffer_t *run : runs)
+      {
+	hb_buffer_clear_contents (buf);
+	hb_buffer_append (buf, run, 0, -1);
+	hb_shape (font, buf, nullptr, 0);
+      }
+  }
+  hb_buffer_destroy (buf);
+
+  for (hb_buffer_t *run : runs)
+    hb_buffer_destroy (run);
+  hb_blob_destroy (text_blob);
+  hb_font_destroy (font);
+}
+
+/* Shapes the first state.range(0) lines of the text as one paragraph,
+ * to show how shaping time grows with the length of the buffer. */
+static void BM_ShapeParagraph (benchmark::State &state,
+			       const test_input_t &input)
+{
+  hb_font_t *font;
+  {
+    hb_blob_t *blob = hb_blob_create_from_file_or_fail (input.font_path);
+    assert (blob);
+    hb_face_t *face = hb_face_create (blob, 0);
+    hb_blob_destroy (blob);
+    font = hb_font_create (face);
+    hb_face_destroy (face);
+  }
+
+  hb_blob_t *text_blob = hb_blob_create_from_file_or_fail (input.text_path);
+  assert (text_blob);
+  unsigned text_length;
+  const char *text = hb_blob_get_data (text_blob, &text_length);
+
+  std::vector<char> paragraph;
+  unsigned num_lines = state.range (0);
+  for (unsigned i = 0; i < num_lines && text_length; i++)
+  {
+    const char *end = (const char *) memchr (text, '\n', text_length);
+    unsigned line_length = end ? end - text : text_length;
+    if (!paragraph.empty ())
+      paragraph.push_back (' ');
+    paragraph.insert (paragraph.end (), text, text + line_length);
+
+    unsigned skip = end ? line_length + 1 : line_length;
+    text_length -= skip;
+    text += skip;
+  }
+
+  hb_buffer_t *buf = hb_buffer_create ();
+  for (auto _ : state)
+  {
+    hb_buffer_clear_contents (buf);
+    hb_buffer_add_utf8 (buf, paragraph.data (), paragraph.size (), 0, paragraph.size ());
+    hb_buffer_guess_segment_properties (buf);
+    hb_shape (font, buf, nullptr, 0);
+  }
+  state.SetBytesProcessed (state.iterations () * paragraph.size ());
+  hb_buffer_destroy (buf);
+
+  hb_blob_destroy (text_blob);
+  hb_font_destroy (font);
+}
+
 static void test_backend (backend_t backend,
 			  const char *backend_name,
 			  bool variable,
@@ -150,6 +259,24 @@ int main(int argc, char** argv)
     }
   }
 
+  test_input_t batch_input = {"perf/fonts/Roboto-Regular.ttf",
+			      "perf/texts/en-words.txt",
+			      false};
+  benchmark::RegisterBenchmark ("BM_ShapeBatch/Roboto-Regular.ttf/en-words.txt",
+				BM_ShapeBatch, batch_input)
+   ->Unit(benchmark::kMillisecond)
+   ->Arg(0)
+   ->Arg(1);
+
+  test_input_t paragraph_input = {"perf/fonts/NotoNastaliqUrdu-Regular.ttf",
+				  "perf/texts/fa-thelittleprince.txt",
+				  false};
+  benchmark::RegisterBenchmark ("BM_ShapeParagraph/NotoNastaliqUrdu-Regular.ttf/fa-thelittleprince.txt",
+				BM_ShapeParagraph, paragraph_input)
+   ->Unit(benchmark::kMillisecond)
+   ->RangeMultiplier(4)
+   ->Range(1, 256);
+
   for (unsigned i = 0; i < num_tests; i++)
   {
     auto& test_input = tests[i];
@@ -39,6 +39,11 @@ struct Ligature
     c->output->add (ligGlyph);
   }
 
+  /* Number of components, including the first. */
+  unsigned int get_component_count () const { return component.lenP1; }
+  /* Component i, starting from the second at 1. */
+  hb_codepoint_t get_component (unsigned int i) const { return component[i]; }
+
   bool would_apply (hb_would_apply_context_t *c) const
   {
     if (c->len != component.lenP1)
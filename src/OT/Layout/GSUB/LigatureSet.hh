@@ -4,6 +4,12 @@
 #include "Common.hh"
 #include "Ligature.hh"
 
+/* Ligature sets with fewer ligatures are tried one by one, without a
+ * trie. */
+#ifndef HB_LIGATURE_TRIE_MIN_LIGATURES
+#define HB_LIGATURE_TRIE_MIN_LIGATURES 4
+#endif
+
 namespace OT {
 namespace Layout {
 namespace GSUB {
@@ -72,6 +78,182 @@ struct LigatureSet
     return_trace (false);
   }
 
+  /* Like apply(), trying only the ligatures whose components the trie
+   * finds in the buffer.  Ligatures failing to match have no effect
+   * other than marking glyphs unsafe to concat, so this is only used
+   * when the buffer does not ask for that. */
+  bool apply (hb_ot_apply_context_t *c,
+              const hb_ligature_trie_t &trie,
+              unsigned int root) const
+  {
+    TRACE_APPLY (this);
+    candidates_t candidates;
+    if (unlikely (!collect_candidates (c, trie, root, c->buffer->idx, &candidates)))
+      return_trace (c->buffer->max_ops > 0 && apply (c));
+
+    for (unsigned int i = 0; i < candidates.length; i++)
+    {
+      const Ligature &lig = this+ligature[candidates.arrayZ[i]];
+      if (lig.apply (c)) return_trace (true);
+    }
+
+    return_trace (false);
+  }
+
+  /* Adds the trie of the ligatures, if there are enough of them, to trie.
+   * Returns its root node. */
+  unsigned int compile_trie (hb_ligature_trie_t *trie) const
+  {
+    unsigned int num_ligs = ligature.len;
+    if (num_ligs < HB_LIGATURE_TRIE_MIN_LIGATURES)
+      return hb_ligature_trie_t::NOT_FOUND;
+
+    /* Ligatures too long to ever match are left out. */
+    hb_vector_t<unsigned int> indices;
+    for (unsigned int i = 0; i < num_ligs; i++)
+    {
+      unsigned int count = (this+ligature[i]).get_component_count ();
+      if (count && count <= HB_MAX_CONTEXT_LENGTH)
+        indices.push (i);
+    }
+    if (unlikely (indices.in_error ()))
+      return hb_ligature_trie_t::NOT_FOUND;
+
+    return compile_node (trie, indices, 1);
+  }
+
+  private:
+  /* Ligatures found by the trie, in set order. */
+  struct candidates_t
+  {
+    bool add (unsigned int index)
+    {
+      if (hb_array (arrayZ, length).lfind (index))
+        return true;
+      if (unlikely (length == ARRAY_LENGTH (arrayZ)))
+        return false;
+      unsigned int i = length++;
+      for (; i && arrayZ[i - 1] > index; i--)
+        arrayZ[i] = arrayZ[i - 1];
+      arrayZ[i] = index;
+      return true;
+    }
+
+    unsigned int length = 0;
+    unsigned int arrayZ[32];
+  };
+
+  /* Adds the ligatures of node and its descendants that may match the
+   * glyphs after pos.  The buffer is walked as the skipping iterator
+   * does in match_input(): a glyph that may be skipped is taken as the
+   * next component of the ligatures that have it, and skipped by the
+   * others.  Returns false if there are too many ligatures, or the
+   * buffer runs out of operations. */
+  static bool collect_candidates (hb_ot_apply_context_t *c,
+                                  const hb_ligature_trie_t &trie,
+                                  unsigned int node_index,
+                                  unsigned int pos,
+                                  candidates_t *candidates)
+  {
+    const hb_ligature_trie_t::node_t &node = trie.nodes.arrayZ[node_index];
+    for (unsigned int i = 0; i < node.num_ligatures; i++)
+      if (unlikely (!candidates->add (trie.ligatures.arrayZ[node.first_ligature + i])))
+        return false;
+    if (!node.num_edges)
+      return true;
+
+    /* Children taken at an earlier glyph; their ligatures took that one. */
+    unsigned int entered[8];
+    unsigned int num_entered = 0;
+
+    hb_buffer_t *buffer = c->buffer;
+    uint8_t syllable = c->per_syllable ? buffer->cur().syllable () : 0;
+    const hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
+    for (unsigned int j = pos + 1; j < buffer->len; j++)
+    {
+      if (unlikely (buffer->max_ops-- <= 0))
+        return false;
+
+      const hb_glyph_info_t &info = buffer->info[j];
+      hb_ot_apply_context_t::matcher_t::may_skip_t skip = skippy_iter.may_skip (info);
+      if (skip == hb_ot_apply_context_t::matcher_t::SKIP_YES)
+        continue;
+
+      /* As matcher_t::may_match(). */
+      unsigned int child = hb_ligature_trie_t::NOT_FOUND;
+      if ((info.mask & c->lookup_mask) &&
+          (!syllable || syllable == info.syllable ()))
+        child = trie.get_child (node, info.codepoint);
+
+      if (child != hb_ligature_trie_t::NOT_FOUND &&
+          !hb_array (entered, num_entered).lfind (child))
+      {
+        if (unlikely (num_entered == ARRAY_LENGTH (entered)))
+          return false;
+        entered[num_entered++] = child;
+        if (!collect_candidates (c, trie, child, j, candidates))
+          return false;
+      }
+
+      if (skip == hb_ot_apply_context_t::matcher_t::SKIP_NO)
+        break;
+    }
+    return true;
+  }
+
+  /* Adds the node for the ligatures of indices, whose first depth
+   * components are the same, and its descendants.  Returns its index. */
+  unsigned int compile_node (hb_ligature_trie_t *trie,
+                             hb_array_t<const unsigned int> indices,
+                             unsigned int depth) const
+  {
+    unsigned int node_index = trie->nodes.length;
+    if (unlikely (!trie->nodes.resize (node_index + 1)))
+      return hb_ligature_trie_t::NOT_FOUND;
+
+    hb_set_t glyphs;
+    unsigned int first_ligature = trie->ligatures.length;
+    for (unsigned int i : indices)
+    {
+      const Ligature &lig = this+ligature[i];
+      if (lig.get_component_count () == depth)
+        trie->ligatures.push (i);
+      else
+        glyphs.add (lig.get_component (depth));
+    }
+
+    unsigned int first_edge = trie->edges.length;
+    unsigned int num_edges = glyphs.get_population ();
+    if (unlikely (glyphs.in_error () || !trie->edges.resize (first_edge + num_edges)))
+      return node_index;
+
+    hb_ligature_trie_t::node_t &node = trie->nodes.arrayZ[node_index];
+    node.first_edge = first_edge;
+    node.num_edges = num_edges;
+    node.first_ligature = first_ligature;
+    node.num_ligatures = trie->ligatures.length - first_ligature;
+
+    hb_vector_t<unsigned int> child_indices;
+    unsigned int edge_index = first_edge;
+    for (hb_codepoint_t g : glyphs)
+    {
+      child_indices.resize (0);
+      for (unsigned int i : indices)
+      {
+        const Ligature &lig = this+ligature[i];
+        if (lig.get_component_count () > depth && lig.get_component (depth) == g)
+          child_indices.push (i);
+      }
+      unsigned int child = compile_node (trie, child_indices, depth + 1);
+      trie->edges.arrayZ[edge_index].glyph = g;
+      trie->edges.arrayZ[edge_index].node = child;
+      edge_index++;
+    }
+    return node_index;
+  }
+
+  public:
+
   bool serialize (hb_serialize_context_t *c,
                   hb_array_t<const HBGlyphID16> ligatures,
                   hb_array_t<const unsigned int> component_count_list,
@@ -85,9 +85,59 @@ struct LigatureSubstFormat1
     if (likely (index == NOT_COVERED)) return_trace (false);
 
     const LigatureSet &lig_set = this+ligatureSet[index];
+    if (!(c->buffer->flags & HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT))
+    {
+      const hb_ligature_trie_t *trie = get_trie (c);
+      unsigned int root = trie ? trie->get_root (index) : hb_ligature_trie_t::NOT_FOUND;
+      if (root != hb_ligature_trie_t::NOT_FOUND)
+        return_trace (lig_set.apply (c, *trie, root));
+    }
     return_trace (lig_set.apply (c));
   }
 
+  /* Builds the tries of the ligature sets; of none, if that fails. */
+  void compile_trie (hb_ligature_trie_t *trie) const
+  {
+    unsigned int count = ligatureSet.len;
+    if (unlikely (!trie->roots.resize (count)))
+      return;
+    for (unsigned int i = 0; i < count; i++)
+      trie->roots.arrayZ[i] = (this+ligatureSet[i]).compile_trie (trie);
+    if (unlikely (trie->in_error ()))
+      trie->roots.resize (0);
+  }
+
+  /* Returns the trie of the subtable, building it on first use, if it
+   * is being applied by its lookup accelerator. */
+  const hb_ligature_trie_t *get_trie (hb_ot_apply_context_t *c) const
+  { return get_trie (c->get_flat_tables (this)); }
+
+  /* Returns the trie kept in flat, building it if not built yet. */
+  const hb_ligature_trie_t *get_trie (const hb_flat_subtable_t *flat) const
+  {
+    if (unlikely (!flat))
+      return nullptr;
+
+  retry:
+    hb_ligature_trie_t *trie = flat->ligature_trie.get ();
+    if (likely (trie))
+      return trie;
+
+    trie = (hb_ligature_trie_t *) hb_calloc (1, sizeof (hb_ligature_trie_t));
+    if (unlikely (!trie))
+      return nullptr;
+    trie->init ();
+    compile_trie (trie);
+
+    if (unlikely (!flat->ligature_trie.cmpexch (nullptr, trie)))
+    {
+      trie->fini ();
+      hb_free (trie);
+      goto retry;
+    }
+    return trie;
+  }
+
   bool serialize (hb_serialize_context_t *c,
                   hb_sorted_array_t<const HBGlyphID16> first_glyphs,
                   hb_array_t<const unsigned int> ligature_per_first_glyph_count_list,
@@ -29,12 +29,34 @@ struct SubstLookup : Lookup
     return lookup_type_is_reverse (type);
   }
 
+  static inline bool lookup_type_is_single (unsigned int lookup_type)
+  { return lookup_type == SubTable::Single; }
+
+  /* Whether the lookup only has single substitutions, which look at no
+   * other glyph, so that it can be applied to each glyph on its own. */
+  bool is_single () const
+  {
+    unsigned int type = get_type ();
+    if (likely (type != SubTable::Extension))
+      return lookup_type_is_single (type);
+    unsigned int count = get_subtable_count ();
+    for (unsigned int i = 0; i < count; i++)
+      if (!lookup_type_is_single (reinterpret_cast<const ExtensionSubst &> (get_subtable (i)).get_type ()))
+	return false;
+    return true;
+  }
+
   bool may_have_non_1to1 () const
   {
     hb_have_non_1to1_context_t c;
     return dispatch (&c);
   }
 
+  /* Whether the lookup only ever replaces one glyph with another, such
+   * that it can be applied without an output buffer. */
+  bool is_inplace () const
+  { return !may_have_non_1to1 (); }
+
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
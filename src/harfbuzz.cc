@@ -16,6 +16,7 @@
 #include "hb-ot-color.cc"
 #include "hb-ot-face.cc"
 #include "hb-ot-font.cc"
+#include "hb-ot-layout-snapshot.cc"
 #include "hb-ot-layout.cc"
 #include "hb-ot-map.cc"
 #include "hb-ot-math.cc"
@@ -40,6 +41,9 @@
 #include "hb-ot-tag.cc"
 #include "hb-ot-var.cc"
 #include "hb-set.cc"
+#include "hb-shape-cache.cc"
+#include "hb-shape-edit.cc"
+#include "hb-shape-parallel.cc"
 #include "hb-shape-plan.cc"
 #include "hb-shape.cc"
 #include "hb-shaper.cc"
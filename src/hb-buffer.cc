@@ -262,7 +262,7 @@ hb_buffer_t::similar (const hb_buffer_t &src)
   unicode = hb_unicode_funcs_reference (src.unicode);
   flags = src.flags;
   cluster_level = src.cluster_level;
-  replacement = src.invisible;
+  replacement = src.replacement;
   invisible = src.invisible;
   not_found = src.not_found;
 }
@@ -759,6 +759,7 @@ hb_buffer_destroy (hb_buffer_t *buffer)
 
   hb_free (buffer->info);
   hb_free (buffer->pos);
+  buffer->scratch_sums.fini ();
 #ifndef HB_NO_BUFFER_MESSAGE
   if (buffer->message_destroy)
     buffer->message_destroy (buffer->message_data);
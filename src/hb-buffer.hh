@@ -119,6 +119,7 @@ struct hb_buffer_t
   hb_glyph_info_t     *info;
   hb_glyph_info_t     *out_info;
   hb_glyph_position_t *pos;
+  hb_vector_t<int64_t> scratch_sums; /* Kept across runs; see GPOS::position_finish_offsets(). */
 
   /* Text before / after the main buffer contents.
    * Always in Unicode, and ordered outward.
@@ -69,11 +69,13 @@ struct cff2_cs_interp_env_t : cs_interp_env_t<ELEM, CFF2Subrs>
 {
   template <typename ACC>
   cff2_cs_interp_env_t (const hb_ubytes_t &str, ACC &acc, unsigned int fd,
-			const int *coords_=nullptr, unsigned int num_coords_=0)
+			const int *coords_=nullptr, unsigned int num_coords_=0,
+			OT::VariationStore::cache_t *region_cache_=nullptr)
     : SUPER (str, acc.globalSubrs, acc.privateDicts[fd].localSubrs)
   {
     coords = coords_;
     num_coords = num_coords_;
+    region_cache = region_cache_;
     varStore = acc.varStore;
     seen_blend = false;
     seen_vsindex_ = false;
@@ -121,7 +123,8 @@ struct cff2_cs_interp_env_t : cs_interp_env_t<ELEM, CFF2Subrs>
 	  SUPER::set_error ();
 	else
 	  varStore->varStore.get_region_scalars (get_ivs (), coords, num_coords,
-						 &scalars[0], region_count);
+						 &scalars[0], region_count,
+						 region_cache);
       }
       seen_blend = true;
     }
@@ -164,6 +167,7 @@ struct cff2_cs_interp_env_t : cs_interp_env_t<ELEM, CFF2Subrs>
   protected:
   const int     *coords;
   unsigned int  num_coords;
+  OT::VariationStore::cache_t *region_cache; /* May be nullptr. */
   const	 CFF2VariationStore *varStore;
   unsigned int  region_count;
   unsigned int  ivs;
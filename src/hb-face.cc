@@ -133,9 +133,11 @@ hb_face_create_for_tables (hb_reference_table_func_t  reference_table_func,
   face->destroy = destroy;
 
   face->num_glyphs.set_relaxed (-1);
+  face->flat_layout_budget = HB_FACE_FLAT_LAYOUT_BUDGET;
 
   face->data.init0 (face);
   face->table.init0 (face);
+  face->shape_plans.init ();
 
   return face;
 }
@@ -288,16 +290,11 @@ hb_face_destroy (hb_face_t *face)
 {
   if (!hb_object_destroy (face)) return;
 
-  for (hb_face_t::plan_node_t *node = face->shape_plans; node; )
-  {
-    hb_face_t::plan_node_t *next = node->next;
-    hb_shape_plan_destroy (node->shape_plan);
-    hb_free (node);
-    node = next;
-  }
+  face->shape_plans.fini ();
 
   face->data.fini ();
   face->table.fini ();
+  hb_blob_destroy (face->layout_snapshot.get_relaxed ());
 
   if (face->destroy)
     face->destroy (face->user_data);
@@ -381,6 +378,35 @@ hb_face_is_immutable (const hb_face_t *face)
   return hb_object_is_immutable (face);
 }
 
+/**
+ * hb_face_freeze:
+ * @face: A face object
+ *
+ * Makes @face immutable and loads, up front, all the tables and
+ * accelerators that shaping would otherwise load lazily on first use,
+ * including the ligature tries of the GSUB lookups, and the data of the
+ * shapers.
+ *
+ * Calling this before sharing @face between threads avoids the threads
+ * racing to create (and then discard) the same data.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_freeze (hb_face_t *face)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+    return;
+
+  hb_face_make_immutable (face);
+
+  face->table.load_shaping_tables ();
+
+#define HB_SHAPER_IMPLEMENT(shaper) face->data.shaper.get ();
+#include "hb-shaper-list.hh"
+#undef HB_SHAPER_IMPLEMENT
+}
+
 
 /**
  * hb_face_reference_table:
@@ -570,6 +596,143 @@ hb_face_get_table_tags (const hb_face_t *face,
 }
 
 
+/*
+ * Shape-plan cache.
+ */
+
+/**
+ * hb_face_set_shape_plan_cache_size:
+ * @face: A face object
+ * @size: The maximum number of shape plans to keep
+ *
+ * Sets the maximum number of shape plans cached on @face by
+ * hb_shape_plan_create_cached2() and friends.  When the cache is full,
+ * the least-recently-used plans are evicted.  If @size is smaller
+ * than the number of currently cached plans, the excess plans are
+ * evicted immediately.  Setting @size to zero disables caching.
+ *
+ * Unlike most other setters, this function can be called on an
+ * immutable face.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_set_shape_plan_cache_size (hb_face_t    *face,
+				   unsigned int  size)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+    return;
+
+  face->shape_plans.set_capacity (size);
+}
+
+/**
+ * hb_face_get_shape_plan_cache_size:
+ * @face: A face object
+ *
+ * Fetches the maximum number of shape plans cached on @face.
+ *
+ * Return value: The shape-plan cache size of @face
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_face_get_shape_plan_cache_size (hb_face_t *face)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+    return 0;
+
+  return face->shape_plans.get_capacity ();
+}
+
+/**
+ * hb_face_get_shape_plan_cache_stats:
+ * @face: A face object
+ * @hits: (out) (optional): Number of cache lookups that found a plan
+ * @misses: (out) (optional): Number of cache lookups that did not find a plan
+ * @evictions: (out) (optional): Number of plans evicted from the cache
+ *
+ * Fetches the shape-plan cache statistics of @face, accumulated since
+ * the face was created.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_get_shape_plan_cache_stats (hb_face_t    *face,
+				    unsigned int *hits,      /* OUT */
+				    unsigned int *misses,    /* OUT */
+				    unsigned int *evictions  /* OUT */)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+  {
+    if (hits) *hits = 0;
+    if (misses) *misses = 0;
+    if (evictions) *evictions = 0;
+    return;
+  }
+
+  face->shape_plans.get_stats (hits, misses, evictions);
+}
+
+
+/*
+ * Layout table flattening.
+ */
+
+/**
+ * hb_face_set_flat_layout_budget:
+ * @face: A face object
+ * @budget: Number of bytes to spend, per GSUB and GPOS table
+ *
+ * Sets how much memory may be spent on converting the Coverage and
+ * ClassDef tables of class-based GSUB/GPOS subtables (like class-based
+ * pair kerning and contextual lookups) of @face into native-endian
+ * direct-index arrays.  Glyph lookups in flattened tables are constant
+ * time instead of a binary search, at the cost of two bytes per glyph
+ * in the range each table spans.
+ *
+ * The budget also covers pair positioning (kerning) subtables, whose
+ * values are decoded ahead of time: format 1 pairs into a hash table,
+ * format 2 class pairs into a matrix.  The decoded values are used with
+ * fonts that do not apply Device tables, that is, without a ppem set and
+ * without variations.
+ *
+ * Tables are flattened in lookup order until the budget is used up.
+ *
+ * The budget is used when the layout tables of @face are first loaded,
+ * so it has to be set before @face is first used for shaping; this
+ * function can be called on an immutable face for that reason.  The
+ * default is zero, which disables flattening.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_set_flat_layout_budget (hb_face_t    *face,
+				unsigned int  budget)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+    return;
+
+  face->flat_layout_budget = budget;
+}
+
+/**
+ * hb_face_get_flat_layout_budget:
+ * @face: A face object
+ *
+ * Fetches the budget set with hb_face_set_flat_layout_budget().
+ *
+ * Return value: The flattening budget of @face, in bytes
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_face_get_flat_layout_budget (hb_face_t *face)
+{
+  return face->flat_layout_budget;
+}
+
+
 /*
  * Character set.
  */
@@ -105,6 +105,9 @@ hb_face_make_immutable (hb_face_t *face);
 HB_EXTERN hb_bool_t
 hb_face_is_immutable (const hb_face_t *face);
 
+HB_EXTERN void
+hb_face_freeze (hb_face_t *face);
+
 
 HB_EXTERN hb_blob_t *
 hb_face_reference_table (const hb_face_t *face,
@@ -141,6 +144,36 @@ hb_face_get_table_tags (const hb_face_t *face,
 			hb_tag_t     *table_tags /* OUT */);
 
 
+/*
+ * Shape-plan cache.
+ */
+
+HB_EXTERN void
+hb_face_set_shape_plan_cache_size (hb_face_t    *face,
+				   unsigned int  size);
+
+HB_EXTERN unsigned int
+hb_face_get_shape_plan_cache_size (hb_face_t *face);
+
+HB_EXTERN void
+hb_face_get_shape_plan_cache_stats (hb_face_t    *face,
+				    unsigned int *hits,      /* OUT */
+				    unsigned int *misses,    /* OUT */
+				    unsigned int *evictions  /* OUT */);
+
+
+/*
+ * Layout table flattening.
+ */
+
+HB_EXTERN void
+hb_face_set_flat_layout_budget (hb_face_t    *face,
+				unsigned int  budget);
+
+HB_EXTERN unsigned int
+hb_face_get_flat_layout_budget (hb_face_t *face);
+
+
 /*
  * Character set.
  */
@@ -36,6 +36,10 @@
 #include "hb-ot-face.hh"
 
 
+#ifndef HB_FACE_FLAT_LAYOUT_BUDGET
+#define HB_FACE_FLAT_LAYOUT_BUDGET 0
+#endif
+
 /*
  * hb_face_t
  */
@@ -55,17 +59,14 @@ struct hb_face_t
   unsigned int index;			/* Face index in a collection, zero-based. */
   mutable hb_atomic_int_t upem;		/* Units-per-EM. */
   mutable hb_atomic_int_t num_glyphs;	/* Number of glyphs. */
+  unsigned int flat_layout_budget;	/* Bytes per GSUB/GPOS for flattened tables. */
+  hb_atomic_ptr_t<hb_blob_t> layout_snapshot; /* Adopted hb_ot_layout_snapshot_t. */
 
   hb_shaper_object_dataset_t<hb_face_t> data;/* Various shaper data. */
   hb_ot_face_t table;			/* All the face's tables. */
 
   /* Cache */
-  struct plan_node_t
-  {
-    hb_shape_plan_t *shape_plan;
-    plan_node_t *next;
-  };
-  hb_atomic_ptr_t<plan_node_t> shape_plans;
+  hb_shape_plan_cache_t shape_plans;
 
   hb_blob_t *reference_table (hb_tag_t tag) const
   {
@@ -34,8 +34,12 @@
 
 #include "hb-ot.h"
 
+#include "hb-ot-layout-common.hh"
+#include "hb-ot-layout-gdef-table.hh"
+
 #include "hb-ot-var-avar-table.hh"
 #include "hb-ot-var-fvar-table.hh"
+#include "hb-ot-var-mvar-table.hh"
 
 
 /**
@@ -1722,6 +1726,21 @@ hb_font_create (hb_face_t *face)
   return font;
 }
 
+/* Frees the font's caches of variation data at its coordinates.  Called
+ * only while changing the font, which nothing else may be using then;
+ * readers never free a cache. */
+static void
+_hb_font_var_store_caches_fini (hb_font_t *font)
+{
+  for (unsigned i = 0; i < HB_FONT_VAR_STORE_COUNT; i++)
+  {
+    OT::VarStoreFontCache *cache = font->var_store_caches[i].get_relaxed ();
+    font->var_store_caches[i].set_relaxed (nullptr);
+    if (cache)
+      cache->destroy ();
+  }
+}
+
 static void
 _hb_font_adopt_var_coords (hb_font_t *font,
 			   int *coords, /* 2.14 normalized */
@@ -1836,6 +1855,7 @@ hb_font_destroy (hb_font_t *font)
   if (!hb_object_destroy (font)) return;
 
   font->data.fini ();
+  _hb_font_var_store_caches_fini (font);
 
   if (font->destroy)
     font->destroy (font->user_data);
@@ -1932,6 +1952,52 @@ hb_font_is_immutable (hb_font_t *font)
   return hb_object_is_immutable (font);
 }
 
+/**
+ * hb_font_freeze:
+ * @font: #hb_font_t to work upon
+ *
+ * Makes @font, its parents and its face immutable, and loads up front
+ * all the data that shaping with @font would otherwise load lazily.  See
+ * hb_face_freeze().
+ *
+ * Besides the data of the face, this creates the caches kept with @font
+ * for its variation coordinates: the region scalars of the GDEF, MVAR,
+ * HVAR, VVAR and CFF2 variation stores, with the GDEF deltas, and, if
+ * @font uses the OpenType font functions, their advance cache.
+ *
+ * A frozen font can be shared by any number of threads shaping with it
+ * concurrently, without those threads contending on first use.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_font_freeze (hb_font_t *font)
+{
+  if (unlikely (!hb_object_is_valid (font)))
+    return;
+
+  if (font->parent)
+    hb_font_freeze (font->parent);
+
+  hb_face_freeze (font->face);
+  hb_font_make_immutable (font);
+
+#define HB_SHAPER_IMPLEMENT(shaper) font->data.shaper.get ();
+#include "hb-shaper-list.hh"
+#undef HB_SHAPER_IMPLEMENT
+
+#ifndef HB_NO_OT_FONT
+  hb_ot_font_create_caches (font);
+#endif
+
+#ifndef HB_NO_VAR
+  font->face->table.MVAR->get_var_cache (font);
+#ifndef HB_NO_OT_LAYOUT
+  font->face->table.GDEF->get_var_cache (font);
+#endif
+#endif
+}
+
 /**
  * hb_font_get_serial:
  * @font: #hb_font_t to work upon
@@ -2037,7 +2103,9 @@ hb_font_set_face (hb_font_t *font,
   if (face == font->face)
     return;
 
-  font->serial++;
+  /* Caches of the old face's variation data go with it. */
+  font->serial_coords = ++font->serial;
+  _hb_font_var_store_caches_fini (font);
 
   if (unlikely (!face))
     face = hb_face_get_empty ();
@@ -2359,6 +2427,7 @@ hb_font_set_variations (hb_font_t            *font,
     return;
 
   font->serial_coords = ++font->serial;
+  _hb_font_var_store_caches_fini (font);
 
   if (!variations_length)
   {
@@ -2420,6 +2489,7 @@ hb_font_set_var_coords_design (hb_font_t    *font,
     return;
 
   font->serial_coords = ++font->serial;
+  _hb_font_var_store_caches_fini (font);
 
   int *normalized = coords_length ? (int *) hb_calloc (coords_length, sizeof (int)) : nullptr;
   float *design_coords = coords_length ? (float *) hb_calloc (coords_length, sizeof (float)) : nullptr;
@@ -2455,6 +2525,7 @@ hb_font_set_var_named_instance (hb_font_t *font,
     return;
 
   font->serial_coords = ++font->serial;
+  _hb_font_var_store_caches_fini (font);
 
   unsigned int coords_length = hb_ot_var_named_instance_get_design_coords (font->face, instance_index, nullptr, nullptr);
 
@@ -2493,6 +2564,7 @@ hb_font_set_var_coords_normalized (hb_font_t    *font,
     return;
 
   font->serial_coords = ++font->serial;
+  _hb_font_var_store_caches_fini (font);
 
   int *copy = coords_length ? (int *) hb_calloc (coords_length, sizeof (coords[0])) : nullptr;
   int *unmapped = coords_length ? (int *) hb_calloc (coords_length, sizeof (coords[0])) : nullptr;
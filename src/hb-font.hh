@@ -101,6 +101,21 @@ DECLARE_NULL_INSTANCE (hb_font_funcs_t);
 #include "hb-shaper-list.hh"
 #undef HB_SHAPER_IMPLEMENT
 
+namespace OT { struct VarStoreFontCache; }
+
+/* Variation stores of the face that a font keeps caches for; see
+ * OT::VariationStore::get_font_cache(). */
+enum hb_font_var_store_t
+{
+  HB_FONT_VAR_STORE_GDEF,
+  HB_FONT_VAR_STORE_HVAR,
+  HB_FONT_VAR_STORE_VVAR,
+  HB_FONT_VAR_STORE_MVAR,
+  HB_FONT_VAR_STORE_CFF2,
+
+  HB_FONT_VAR_STORE_COUNT
+};
+
 struct hb_font_t
 {
   hb_object_header_t header;
@@ -132,6 +147,7 @@ struct hb_font_t
   hb_destroy_func_t  destroy;
 
   hb_shaper_object_dataset_t<hb_font_t> data; /* Various shaper data. */
+  hb_atomic_ptr_t<OT::VarStoreFontCache> var_store_caches[HB_FONT_VAR_STORE_COUNT];
 
 
   /* Convert from font-space to user-space */
@@ -649,5 +665,10 @@ struct hb_font_t
 };
 DECLARE_NULL_INSTANCE (hb_font_t);
 
+#ifndef HB_NO_OT_FONT
+HB_INTERNAL void
+hb_ot_font_create_caches (hb_font_t *font);
+#endif
+
 
 #endif /* HB_FONT_HH */
@@ -53,6 +53,7 @@
 typedef pthread_mutex_t hb_mutex_impl_t;
 #define hb_mutex_impl_init(M)	pthread_mutex_init (M, nullptr)
 #define hb_mutex_impl_lock(M)	pthread_mutex_lock (M)
+#define hb_mutex_impl_try_lock(M)	(pthread_mutex_trylock (M) == 0)
 #define hb_mutex_impl_unlock(M)	pthread_mutex_unlock (M)
 #define hb_mutex_impl_finish(M)	pthread_mutex_destroy (M)
 
@@ -66,6 +67,7 @@ typedef CRITICAL_SECTION hb_mutex_impl_t;
 #define hb_mutex_impl_init(M)	InitializeCriticalSection (M)
 #endif
 #define hb_mutex_impl_lock(M)	EnterCriticalSection (M)
+#define hb_mutex_impl_try_lock(M)	(TryEnterCriticalSection (M) != 0)
 #define hb_mutex_impl_unlock(M)	LeaveCriticalSection (M)
 #define hb_mutex_impl_finish(M)	DeleteCriticalSection (M)
 
@@ -76,6 +78,7 @@ typedef CRITICAL_SECTION hb_mutex_impl_t;
 typedef std::mutex              hb_mutex_impl_t;
 #define hb_mutex_impl_init(M)   HB_STMT_START { new (M) hb_mutex_impl_t; } HB_STMT_END
 #define hb_mutex_impl_lock(M)   (M)->lock ()
+#define hb_mutex_impl_try_lock(M) (M)->try_lock ()
 #define hb_mutex_impl_unlock(M) (M)->unlock ()
 #define hb_mutex_impl_finish(M) HB_STMT_START { (M)->~hb_mutex_impl_t(); } HB_STMT_END
 
@@ -85,12 +88,18 @@ typedef std::mutex              hb_mutex_impl_t;
 typedef int hb_mutex_impl_t;
 #define hb_mutex_impl_init(M)	HB_STMT_START {} HB_STMT_END
 #define hb_mutex_impl_lock(M)	HB_STMT_START {} HB_STMT_END
+#define hb_mutex_impl_try_lock(M)	true
 #define hb_mutex_impl_unlock(M)	HB_STMT_START {} HB_STMT_END
 #define hb_mutex_impl_finish(M)	HB_STMT_START {} HB_STMT_END
 
 
 #endif
 
+#ifndef hb_mutex_impl_try_lock
+/* Optional; without it, trying to lock always fails. */
+#define hb_mutex_impl_try_lock(M)	false
+#endif
+
 
 struct hb_mutex_t
 {
@@ -101,6 +110,7 @@ struct hb_mutex_t
 #pragma GCC diagnostic ignored "-Wcast-align"
   void init   () { hb_mutex_impl_init   ((hb_mutex_impl_t *) m); }
   void lock   () { hb_mutex_impl_lock   ((hb_mutex_impl_t *) m); }
+  bool try_lock () { return hb_mutex_impl_try_lock ((hb_mutex_impl_t *) m); }
   void unlock () { hb_mutex_impl_unlock ((hb_mutex_impl_t *) m); }
   void fini   () { hb_mutex_impl_finish ((hb_mutex_impl_t *) m); }
 #pragma GCC diagnostic pop
@@ -34,6 +34,15 @@
 
 using namespace CFF;
 
+/* Region scalars of the variation store at the coordinates of a font,
+ * kept with the font for all glyphs to share. */
+static OT::VariationStore::cache_t *
+_hb_cff2_get_var_scalars (const CFF2VariationStore *varStore, hb_font_t *font)
+{
+  const OT::VariationStore::font_cache_t *cache = varStore->varStore.get_font_cache (font, HB_FONT_VAR_STORE_CFF2, false);
+  return cache ? cache->scalars : nullptr;
+}
+
 struct cff2_extents_param_t
 {
   cff2_extents_param_t ()
@@ -112,7 +121,8 @@ bool OT::cff2::accelerator_t::get_extents (hb_font_t *font,
 
   unsigned int fd = fdSelect->get_fd (glyph);
   const hb_ubytes_t str = (*charStrings)[glyph];
-  cff2_cs_interp_env_t<number_t> env (str, *this, fd, font->coords, font->num_coords);
+  cff2_cs_interp_env_t<number_t> env (str, *this, fd, font->coords, font->num_coords,
+				      _hb_cff2_get_var_scalars (varStore, font));
   cff2_cs_interpreter_t<cff2_cs_opset_extents_t, cff2_extents_param_t, number_t> interp (env);
   cff2_extents_param_t  param;
   if (unlikely (!interp.interpret (param))) return false;
@@ -201,7 +211,8 @@ bool OT::cff2::accelerator_t::get_path (hb_font_t *font, hb_codepoint_t glyph, h
 
   unsigned int fd = fdSelect->get_fd (glyph);
   const hb_ubytes_t str = (*charStrings)[glyph];
-  cff2_cs_interp_env_t<number_t> env (str, *this, fd, font->coords, font->num_coords);
+  cff2_cs_interp_env_t<number_t> env (str, *this, fd, font->coords, font->num_coords,
+				      _hb_cff2_get_var_scalars (varStore, font));
   cff2_cs_interpreter_t<cff2_cs_opset_path_t, cff2_path_param_t, number_t> interp (env);
   cff2_path_param_t param (font, draw_session);
   if (unlikely (!interp.interpret (param))) return false;
@@ -27,6 +27,7 @@
 #ifndef HB_OT_CMAP_TABLE_HH
 #define HB_OT_CMAP_TABLE_HH
 
+#include "hb-cache.hh"
 #include "hb-open-type.hh"
 #include "hb-set.hh"
 
@@ -415,8 +416,12 @@ struct CmapSubtableFormat4
 					  this->segCount + 1);
       if (unlikely (!found))
 	return false;
-      unsigned int i = found - endCount;
+      return get_glyph_in_segment (found - endCount, codepoint, glyph);
+    }
 
+    /* Codepoint must lie within segment i. */
+    bool get_glyph_in_segment (unsigned int i, hb_codepoint_t codepoint, hb_codepoint_t *glyph) const
+    {
       hb_codepoint_t gid;
       unsigned int rangeOffset = this->idRangeOffset[i];
       if (rangeOffset == 0)
@@ -1744,32 +1749,66 @@ struct cmap
 	  break;
 	}
 	}
+
+	switch (subtable->u.format) {
+	default: break;
+	case 12: this->segment_index.init (subtable->u.format12); break;
+	case  4: this->segment_index.init (this->format4_accel); break;
+	}
       }
     }
-    ~accelerator_t () { this->table.destroy (); }
+    ~accelerator_t ()
+    {
+      this->segment_index.fini ();
+      this->table.destroy ();
+    }
 
     bool get_nominal_glyph (hb_codepoint_t  unicode,
-			    hb_codepoint_t *glyph) const
+			    hb_codepoint_t *glyph,
+			    hb_cmap_cache_t *cache = nullptr) const
     {
       if (unlikely (!this->get_glyph_funcZ)) return false;
-      return this->get_glyph_funcZ (this->get_glyph_data, unicode, glyph);
+
+      unsigned v;
+      if (cache && cache->get (unicode, &v))
+      {
+	*glyph = v;
+	return true;
+      }
+
+      unsigned hint = (unsigned) -1;
+      bool ret = get_glyph_uncached (unicode, glyph, &hint);
+
+      if (cache && ret)
+	cache->set (unicode, *glyph);
+      return ret;
     }
     unsigned int get_nominal_glyphs (unsigned int count,
 				     const hb_codepoint_t *first_unicode,
 				     unsigned int unicode_stride,
 				     hb_codepoint_t *first_glyph,
-				     unsigned int glyph_stride) const
+				     unsigned int glyph_stride,
+				     hb_cmap_cache_t *cache = nullptr) const
     {
       if (unlikely (!this->get_glyph_funcZ)) return 0;
 
-      hb_cmap_get_glyph_func_t get_glyph_funcZ = this->get_glyph_funcZ;
-      const void *get_glyph_data = this->get_glyph_data;
+      /* Consecutive characters tend to fall in the same segment. */
+      unsigned hint = (unsigned) -1;
 
       unsigned int done;
-      for (done = 0;
-	   done < count && get_glyph_funcZ (get_glyph_data, *first_unicode, first_glyph);
-	   done++)
+      for (done = 0; done < count; done++)
       {
+	unsigned v;
+	if (cache && cache->get (*first_unicode, &v))
+	  *first_glyph = v;
+	else if (get_glyph_uncached (*first_unicode, first_glyph, &hint))
+	{
+	  if (cache)
+	    cache->set (*first_unicode, *first_glyph);
+	}
+	else
+	  break;
+
 	first_unicode = &StructAtOffsetUnaligned<hb_codepoint_t> (first_unicode, unicode_stride);
 	first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
       }
@@ -1808,6 +1847,143 @@ struct cmap
 					      hb_codepoint_t codepoint,
 					      hb_codepoint_t *glyph);
 
+    bool get_glyph_uncached (hb_codepoint_t  unicode,
+			     hb_codepoint_t *glyph,
+			     unsigned       *hint) const
+    {
+      if (segment_index.has_data ())
+	return segment_index.get_glyph (unicode, glyph, hint, format4_accel);
+      return this->get_glyph_funcZ (this->get_glyph_data, unicode, glyph);
+    }
+
+    /* Native-endian copy of the segments of a format 4 or 12 subtable,
+     * searched with a branch-free binary search.  Only built for
+     * well-formed subtables, so results match the regular lookup. */
+    struct segment_index_t
+    {
+      void init (const CmapSubtableFormat4::accelerator_t &accel)
+      {
+	format12 = false;
+	unsigned count = accel.segCount;
+	if (unlikely (!alloc (count))) return;
+	for (unsigned i = 0; i < count; i++)
+	{
+	  hb_codepoint_t start = accel.startCount[i];
+	  hb_codepoint_t end = accel.endCount[i];
+	  if (unlikely (start > end || (i && start <= ends.arrayZ[i - 1])))
+	  {
+	    fini ();
+	    return;
+	  }
+	  ends.arrayZ[i] = end;
+	  segments.arrayZ[i].start = start;
+	  segments.arrayZ[i].delta = accel.idRangeOffset[i] ? RANGE_OFFSET : (unsigned) accel.idDelta[i];
+	}
+      }
+
+      void init (const CmapSubtableFormat12 &subtable)
+      {
+	format12 = true;
+	const auto &groups = subtable.groups;
+	unsigned count = groups.len;
+	if (unlikely (!alloc (count))) return;
+	for (unsigned i = 0; i < count; i++)
+	{
+	  hb_codepoint_t start = groups.arrayZ[i].startCharCode;
+	  hb_codepoint_t end = groups.arrayZ[i].endCharCode;
+	  if (unlikely (start > end || (i && start <= ends.arrayZ[i - 1])))
+	  {
+	    fini ();
+	    return;
+	  }
+	  ends.arrayZ[i] = end;
+	  segments.arrayZ[i].start = start;
+	  /* Wraps around; so does the regular lookup. */
+	  segments.arrayZ[i].delta = groups.arrayZ[i].glyphID - start;
+	}
+      }
+
+      void fini ()
+      {
+	ends.fini ();
+	segments.fini ();
+      }
+
+      bool has_data () const { return ends.length; }
+
+      bool get_glyph (hb_codepoint_t  codepoint,
+		      hb_codepoint_t *glyph,
+		      unsigned       *hint,
+		      const CmapSubtableFormat4::accelerator_t &format4_accel) const
+      {
+	unsigned i = *hint;
+	if (!(i < ends.length &&
+	      codepoint <= ends.arrayZ[i] &&
+	      codepoint >= segments.arrayZ[i].start))
+	{
+	  i = lower_bound (codepoint);
+	  if (unlikely (i == ends.length))
+	    return false;
+	  *hint = i;
+	}
+
+	const segment_t &segment = segments.arrayZ[i];
+	if (codepoint < segment.start)
+	  return false;
+
+	hb_codepoint_t gid;
+	if (format12)
+	  gid = codepoint + segment.delta;
+	else if (likely (segment.delta != RANGE_OFFSET))
+	  gid = (codepoint + segment.delta) & 0xFFFFu;
+	else
+	  return format4_accel.get_glyph_in_segment (i, codepoint, glyph);
+
+	if (unlikely (!gid))
+	  return false;
+	*glyph = gid;
+	return true;
+      }
+
+      private:
+      bool alloc (unsigned count)
+      {
+	if (unlikely (!ends.resize (count) || !segments.resize (count)))
+	{
+	  fini ();
+	  return false;
+	}
+	return true;
+      }
+
+      /* Index of the first segment ending at or after codepoint. */
+      unsigned lower_bound (hb_codepoint_t codepoint) const
+      {
+	const uint32_t *base = ends.arrayZ;
+	unsigned n = ends.length;
+	while (n > 1)
+	{
+	  unsigned half = n / 2;
+	  base = base[half] < codepoint ? base + half : base;
+	  n -= half;
+	}
+	return (base - ends.arrayZ) + (*base < codepoint);
+      }
+
+      /* For format 4 segments using idRangeOffset. */
+      static constexpr unsigned RANGE_OFFSET = 0x10000u;
+
+      struct segment_t
+      {
+	hb_codepoint_t start;
+	unsigned delta;
+      };
+
+      hb_vector_t<uint32_t> ends;
+      hb_vector_t<segment_t> segments;
+      bool format12 = false;
+    };
+
     template <typename Type>
     HB_INTERNAL static bool get_glyph_from (const void *obj,
 					    hb_codepoint_t codepoint,
@@ -1847,6 +2023,7 @@ struct cmap
     const void *get_glyph_data;
 
     CmapSubtableFormat4::accelerator_t format4_accel;
+    segment_index_t segment_index;
 
     public:
     hb_blob_ptr_t<cmap> table;
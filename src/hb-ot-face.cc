@@ -56,3 +56,25 @@ void hb_ot_face_t::fini ()
 #include "hb-ot-face-table-list.hh"
 #undef HB_OT_TABLE
 }
+
+void hb_ot_face_t::load_shaping_tables ()
+{
+  face->get_upem ();
+  face->get_num_glyphs ();
+
+#if !defined(HB_NO_FACE_COLLECT_UNICODES) || !defined(HB_NO_OT_FONT)
+  cmap.get_stored ();
+#endif
+  hmtx->get_decoded_advances ();
+#ifndef HB_NO_VERTICAL
+  vmtx->get_decoded_advances ();
+#endif
+#ifndef HB_NO_OT_KERN
+  kern.get_blob ();
+#endif
+#ifndef HB_NO_OT_LAYOUT
+  GDEF.get_stored ();
+  GSUB->build_tries ();
+  GPOS.get_stored ();
+#endif
+}
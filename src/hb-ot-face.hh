@@ -50,6 +50,9 @@ struct hb_ot_face_t
   HB_INTERNAL void init0 (hb_face_t *face);
   HB_INTERNAL void fini ();
 
+  /* Loads all tables and accelerators used for shaping up front. */
+  HB_INTERNAL void load_shaping_tables ();
+
 #define HB_OT_TABLE_ORDER(Namespace, Type) \
     HB_PASTE (ORDER_, HB_PASTE (Namespace, HB_PASTE (_, Type)))
   enum order_t
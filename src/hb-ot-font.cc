@@ -59,13 +59,146 @@
  * never need to call these functions directly.
  **/
 
+#ifndef HB_NO_VAR
+
+#ifndef HB_OT_FONT_ADVANCE_CACHE_INSTANCES
+#define HB_OT_FONT_ADVANCE_CACHE_INSTANCES 8
+#endif
+
+/* Advance cache for one set of normalized variation coordinates.
+ * Shared by all fonts of a face currently set to those coordinates. */
+struct hb_ot_font_advance_cache_t
+{
+  hb_reference_count_t ref_count;
+  hb_vector_t<int> coords;
+  hb_advance_cache_t cache;
+
+  static hb_ot_font_advance_cache_t *create (hb_array_t<const int> coords)
+  {
+    hb_ot_font_advance_cache_t *c = (hb_ot_font_advance_cache_t *) hb_calloc (1, sizeof (hb_ot_font_advance_cache_t));
+    if (unlikely (!c))
+      return nullptr;
+
+    c->ref_count.init ();
+    c->coords.init ();
+    c->cache.init ();
+    if (unlikely (!c->coords.resize (coords.length)))
+    {
+      c->destroy ();
+      return nullptr;
+    }
+    hb_memcpy (c->coords.arrayZ, coords.arrayZ, coords.get_size ());
+    return c;
+  }
+
+  hb_ot_font_advance_cache_t *reference () { ref_count.inc (); return this; }
+
+  void destroy ()
+  {
+    if (ref_count.dec () != 1)
+      return;
+    ref_count.fini ();
+    coords.fini ();
+    cache.fini ();
+    hb_free (this);
+  }
+};
+
+/* Per-face set of advance caches, for the most recently used coordinates.
+ * Kept in least-recently-used order and attached to the face as user-data,
+ * such that fonts switching between a few instances keep their caches warm. */
+struct hb_ot_font_advance_caches_t
+{
+  hb_mutex_t lock;
+  hb_vector_t<hb_ot_font_advance_cache_t *> caches; /* Most recently used last. */
+  unsigned hits;
+  unsigned misses;
+  unsigned evictions;
+
+  static hb_user_data_key_t key;
+
+  static void destroy (void *data)
+  {
+    hb_ot_font_advance_caches_t *c = (hb_ot_font_advance_caches_t *) data;
+    for (auto *cache : c->caches)
+      cache->destroy ();
+    c->caches.fini ();
+    c->lock.fini ();
+    hb_free (c);
+  }
+
+  static hb_ot_font_advance_caches_t *get (hb_face_t *face, bool create = true)
+  {
+    auto *c = (hb_ot_font_advance_caches_t *) hb_face_get_user_data (face, &key);
+    if (likely (c) || !create)
+      return c;
+
+    c = (hb_ot_font_advance_caches_t *) hb_calloc (1, sizeof (hb_ot_font_advance_caches_t));
+    if (unlikely (!c))
+      return nullptr;
+    c->lock.init ();
+    c->caches.init ();
+
+    if (unlikely (!hb_face_set_user_data (face, &key, c, destroy, false)))
+    {
+      /* Lost a race to another font, or the face is inert. */
+      destroy (c);
+      return (hb_ot_font_advance_caches_t *) hb_face_get_user_data (face, &key);
+    }
+    return c;
+  }
+
+  /* Returns a new reference to the cache for @coords. */
+  hb_ot_font_advance_cache_t *acquire (hb_array_t<const int> coords)
+  {
+    hb_lock_t l (lock);
+
+    for (unsigned i = caches.length; i--;)
+      if (coords == caches[i]->coords.as_array ())
+      {
+	hits++;
+	hb_ot_font_advance_cache_t *cache = caches[i];
+	for (unsigned j = i + 1; j < caches.length; j++)
+	  caches[j - 1] = caches[j];
+	caches[caches.length - 1] = cache;
+	return cache->reference ();
+      }
+
+    misses++;
+    hb_ot_font_advance_cache_t *cache = hb_ot_font_advance_cache_t::create (coords);
+    if (unlikely (!cache))
+      return nullptr;
+
+    if (caches.length >= HB_OT_FONT_ADVANCE_CACHE_INSTANCES)
+    {
+      evictions++;
+      caches[0]->destroy ();
+      caches.remove (0);
+    }
+    caches.push (cache);
+    if (unlikely (caches.in_error ()))
+      return cache;
+
+    return cache->reference ();
+  }
+};
+
+hb_user_data_key_t hb_ot_font_advance_caches_t::key;
+
+#endif
+
 struct hb_ot_font_t
 {
   const hb_ot_face_t *ot_face;
 
+  /* nominal glyph caching */
+  mutable hb_cmap_cache_t cmap_cache;
+
+#ifndef HB_NO_VAR
   /* h_advance caching */
   mutable hb_atomic_int_t cached_coords_serial;
-  mutable hb_atomic_ptr_t<hb_advance_cache_t> advance_cache;
+  mutable hb_atomic_ptr_t<hb_ot_font_advance_cache_t> advance_cache;
+#endif
 };
 
 static hb_ot_font_t *
@@ -76,6 +209,7 @@ _hb_ot_font_create (hb_font_t *font)
     return nullptr;
 
   ot_font->ot_face = &font->face->table;
+  ot_font->cmap_cache.init ();
 
   return ot_font;
 }
@@ -85,15 +219,56 @@ _hb_ot_font_destroy (void *font_data)
 {
   hb_ot_font_t *ot_font = (hb_ot_font_t *) font_data;
 
+  ot_font->cmap_cache.fini ();
+
+#ifndef HB_NO_VAR
   auto *cache = ot_font->advance_cache.get_relaxed ();
   if (cache)
+    cache->destroy ();
+#endif
+
+  hb_free (ot_font);
+}
+
+#ifndef HB_NO_VAR
+/* Returns the advance cache for the current coordinates of @font.  If
+ * *release is set on return, the caller must destroy it when done. */
+static hb_advance_cache_t *
+_hb_ot_font_get_advance_cache (const hb_ot_font_t *ot_font,
+			       hb_font_t *font,
+			       hb_ot_font_advance_cache_t **release)
+{
+  *release = nullptr;
+
+  /* Coordinates cannot change while the font is in use, so a matching
+   * serial guarantees the pointer below is the one set along with it. */
+  if (ot_font->cached_coords_serial.get () == (int) font->serial_coords)
   {
-    cache->fini ();
-    hb_free (cache);
+    hb_ot_font_advance_cache_t *cache = ot_font->advance_cache.get ();
+    if (likely (cache))
+      return &cache->cache;
   }
 
-  hb_free (ot_font);
+  hb_ot_font_advance_caches_t *caches = hb_ot_font_advance_caches_t::get (font->face);
+  if (unlikely (!caches))
+    return nullptr;
+  hb_ot_font_advance_cache_t *cache = caches->acquire (hb_array (font->coords, font->num_coords));
+  if (unlikely (!cache))
+    return nullptr;
+
+  hb_ot_font_advance_cache_t *old = ot_font->advance_cache.get ();
+  if (likely (ot_font->advance_cache.cmpexch (old, cache)))
+  {
+    ot_font->cached_coords_serial.set (font->serial_coords);
+    if (old)
+      old->destroy ();
+  }
+  else
+    *release = cache;
+
+  return &cache->cache;
 }
+#endif
 
 static hb_bool_t
 hb_ot_get_nominal_glyph (hb_font_t *font HB_UNUSED,
@@ -104,7 +279,7 @@ hb_ot_get_nominal_glyph (hb_font_t *font HB_UNUSED,
 {
   const hb_ot_font_t *ot_font = (const hb_ot_font_t *) font_data;
   const hb_ot_face_t *ot_face = ot_font->ot_face;
-  return ot_face->cmap->get_nominal_glyph (unicode, glyph);
+  return ot_face->cmap->get_nominal_glyph (unicode, glyph, &ot_font->cmap_cache);
 }
 
 static unsigned int
@@ -121,7 +296,8 @@ hb_ot_get_nominal_glyphs (hb_font_t *font HB_UNUSED,
   const hb_ot_face_t *ot_face = ot_font->ot_face;
   return ot_face->cmap->get_nominal_glyphs (count,
 					    first_unicode, unicode_stride,
-					    first_glyph, glyph_stride);
+					    first_glyph, glyph_stride,
+					    &ot_font->cmap_cache);
 }
 
 static hb_bool_t
@@ -153,40 +329,32 @@ hb_ot_get_glyph_h_advances (hb_font_t* font, void* font_data,
 #ifndef HB_NO_VAR
   const OT::HVARVVAR &HVAR = *hmtx.var_table;
   const OT::VariationStore &varStore = &HVAR + HVAR.varStore;
-  OT::VariationStore::cache_t *varStore_cache = font->num_coords * count >= 128 ? varStore.create_cache () : nullptr;
+  const OT::VariationStore::font_cache_t *varStore_font_cache = varStore.get_font_cache (font, HB_FONT_VAR_STORE_HVAR, false);
+  OT::VariationStore::cache_t *varStore_cache = varStore_font_cache ? varStore_font_cache->scalars : nullptr;
 
-  bool use_cache = font->num_coords;
+  hb_ot_font_advance_cache_t *release = nullptr;
+  hb_advance_cache_t *cache = font->num_coords ? _hb_ot_font_get_advance_cache (ot_font, font, &release) : nullptr;
 #else
   OT::VariationStore::cache_t *varStore_cache = nullptr;
-  bool use_cache = false;
+  hb_advance_cache_t *cache = nullptr;
 #endif
 
-  hb_advance_cache_t *cache = nullptr;
-  if (use_cache)
+  const uint16_t *advances = nullptr;
+  if (!font->num_coords)
+    advances = hmtx.get_decoded_advances ();
+
+  if (advances)
   {
-  retry:
-    cache = ot_font->advance_cache.get ();
-    if (unlikely (!cache))
+    unsigned int num_advances = hmtx.get_num_decoded_advances ();
+    for (unsigned int i = 0; i < count; i++)
     {
-      cache = (hb_advance_cache_t *) hb_malloc (sizeof (hb_advance_cache_t));
-      if (unlikely (!cache))
-      {
-	use_cache = false;
-	goto out;
-      }
-
-      cache->init ();
-      if (unlikely (!ot_font->advance_cache.cmpexch (nullptr, cache)))
-      {
-	hb_free (cache);
-	goto retry;
-      }
-      ot_font->cached_coords_serial.set (font->serial_coords);
+      hb_codepoint_t glyph = *first_glyph;
+      *first_advance = font->em_scale_x (likely (glyph < num_advances) ? advances[glyph] : hmtx.get_advance (glyph));
+      first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
+      first_advance = &StructAtOffsetUnaligned<hb_position_t> (first_advance, advance_stride);
     }
   }
-  out:
-
-  if (!use_cache)
+  else if (!cache)
   {
     for (unsigned int i = 0; i < count; i++)
     {
@@ -197,22 +365,16 @@ hb_ot_get_glyph_h_advances (hb_font_t* font, void* font_data,
   }
   else
   { /* Use cache. */
-    if (ot_font->cached_coords_serial.get () != (int) font->serial_coords)
-    {
-      ot_font->advance_cache->init ();
-      ot_font->cached_coords_serial.set (font->serial_coords);
-    }
-
     for (unsigned int i = 0; i < count; i++)
     {
       hb_position_t v;
       unsigned cv;
-      if (ot_font->advance_cache->get (*first_glyph, &cv))
+      if (cache->get (*first_glyph, &cv))
 	v = cv;
       else
       {
         v = hmtx.get_advance (*first_glyph, font, varStore_cache);
-	ot_font->advance_cache->set (*first_glyph, v);
+	cache->set (*first_glyph, v);
       }
       *first_advance = font->em_scale_x (v);
       first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
@@ -221,7 +383,8 @@ hb_ot_get_glyph_h_advances (hb_font_t* font, void* font_data,
   }
 
 #ifndef HB_NO_VAR
-  OT::VariationStore::destroy_cache (varStore_cache);
+  if (release)
+    release->destroy ();
 #endif
 }
 
@@ -244,21 +407,36 @@ hb_ot_get_glyph_v_advances (hb_font_t* font, void* font_data,
 #ifndef HB_NO_VAR
     const OT::HVARVVAR &VVAR = *vmtx.var_table;
     const OT::VariationStore &varStore = &VVAR + VVAR.varStore;
-    OT::VariationStore::cache_t *varStore_cache = font->num_coords ? varStore.create_cache () : nullptr;
+    const OT::VariationStore::font_cache_t *varStore_font_cache = varStore.get_font_cache (font, HB_FONT_VAR_STORE_VVAR, false);
+    OT::VariationStore::cache_t *varStore_cache = varStore_font_cache ? varStore_font_cache->scalars : nullptr;
 #else
     OT::VariationStore::cache_t *varStore_cache = nullptr;
 #endif
 
-    for (unsigned int i = 0; i < count; i++)
+    const uint16_t *advances = nullptr;
+    if (!font->num_coords)
+      advances = vmtx.get_decoded_advances ();
+
+    if (advances)
     {
-      *first_advance = font->em_scale_y (-(int) vmtx.get_advance (*first_glyph, font, varStore_cache));
-      first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
-      first_advance = &StructAtOffsetUnaligned<hb_position_t> (first_advance, advance_stride);
+      unsigned int num_advances = vmtx.get_num_decoded_advances ();
+      for (unsigned int i = 0; i < count; i++)
+      {
+	hb_codepoint_t glyph = *first_glyph;
+	*first_advance = font->em_scale_y (-(int) (likely (glyph < num_advances) ? advances[glyph] : vmtx.get_advance (glyph)));
+	first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
+	first_advance = &StructAtOffsetUnaligned<hb_position_t> (first_advance, advance_stride);
+      }
+    }
+    else
+    {
+      for (unsigned int i = 0; i < count; i++)
+      {
+	*first_advance = font->em_scale_y (-(int) vmtx.get_advance (*first_glyph, font, varStore_cache));
+	first_glyph = &StructAtOffsetUnaligned<hb_codepoint_t> (first_glyph, glyph_stride);
+	first_advance = &StructAtOffsetUnaligned<hb_position_t> (first_advance, advance_stride);
+      }
     }
-
-#ifndef HB_NO_VAR
-    OT::VariationStore::destroy_cache (varStore_cache);
-#endif
   }
   else
   {
@@ -480,6 +658,42 @@ _hb_ot_get_font_funcs ()
   return static_ot_funcs.get_unconst ();
 }
 
+/* Creates, up front, the per-font caches the OpenType font functions
+ * would otherwise create on first use, if @font uses them: the advance
+ * cache, and the region scalars of HVAR, VVAR and CFF2, for the current
+ * variation coordinates. */
+void
+hb_ot_font_create_caches (hb_font_t *font)
+{
+#ifndef HB_NO_VAR
+  if (font->klass != _hb_ot_get_font_funcs () || !font->num_coords)
+    return;
+
+  const hb_ot_font_t *ot_font = (const hb_ot_font_t *) font->user_data;
+  const hb_ot_face_t *ot_face = ot_font->ot_face;
+
+  hb_ot_font_advance_cache_t *release = nullptr;
+  _hb_ot_font_get_advance_cache (ot_font, font, &release);
+  if (release)
+    release->destroy ();
+
+  const OT::HVARVVAR &HVAR = *ot_face->hmtx->var_table;
+  (&HVAR + HVAR.varStore).get_font_cache (font, HB_FONT_VAR_STORE_HVAR, false);
+#ifndef HB_NO_VERTICAL
+  if (ot_face->vmtx->has_data ())
+  {
+    const OT::HVARVVAR &VVAR = *ot_face->vmtx->var_table;
+    (&VVAR + VVAR.varStore).get_font_cache (font, HB_FONT_VAR_STORE_VVAR, false);
+  }
+#endif
+#ifndef HB_NO_CFF
+  const OT::cff2_accelerator_t &cff2 = *ot_face->cff2;
+  if (cff2.is_valid ())
+    cff2.varStore->varStore.get_font_cache (font, HB_FONT_VAR_STORE_CFF2, false);
+#endif
+#endif
+}
+
 
 /**
  * hb_ot_font_set_funcs:
@@ -502,6 +716,42 @@ hb_ot_font_set_funcs (hb_font_t *font)
 		     _hb_ot_font_destroy);
 }
 
+/**
+ * hb_ot_font_get_advance_cache_stats:
+ * @font: #hb_font_t to work upon
+ * @hits: (out) (optional): Number of times a cached instance was reused
+ * @misses: (out) (optional): Number of times a new instance had to be cached
+ * @evictions: (out) (optional): Number of instances dropped to make room
+ *
+ * Fetches statistics of the variation-instance advance cache shared by the
+ * fonts of the face of @font.  The counters are only updated when a font
+ * using the OpenType font functions changes its variation coordinates, and
+ * all remain zero if no such font has been used for shaping.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_ot_font_get_advance_cache_stats (hb_font_t    *font,
+				    unsigned int *hits,      /* OUT */
+				    unsigned int *misses,    /* OUT */
+				    unsigned int *evictions  /* OUT */)
+{
+  unsigned h = 0, m = 0, e = 0;
+#ifndef HB_NO_VAR
+  hb_ot_font_advance_caches_t *caches = hb_ot_font_advance_caches_t::get (font->face, false);
+  if (caches)
+  {
+    hb_lock_t l (caches->lock);
+    h = caches->hits;
+    m = caches->misses;
+    e = caches->evictions;
+  }
+#endif
+  if (hits) *hits = h;
+  if (misses) *misses = m;
+  if (evictions) *evictions = e;
+}
+
 #ifndef HB_NO_VAR
 int
 _glyf_get_side_bearing_var (hb_font_t *font, hb_codepoint_t glyph, bool is_vertical)
@@ -39,6 +39,12 @@ HB_BEGIN_DECLS
 HB_EXTERN void
 hb_ot_font_set_funcs (hb_font_t *font);
 
+HB_EXTERN void
+hb_ot_font_get_advance_cache_stats (hb_font_t    *font,
+				    unsigned int *hits,      /* OUT */
+				    unsigned int *misses,    /* OUT */
+				    unsigned int *evictions  /* OUT */);
+
 
 HB_END_DECLS
 
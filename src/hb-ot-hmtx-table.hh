@@ -215,6 +215,7 @@ struct hmtxvmtx
     }
     ~accelerator_t ()
     {
+      hb_free (decoded_advances.get_relaxed ());
       table.destroy ();
       var_table.destroy ();
     }
@@ -283,6 +284,37 @@ struct hmtxvmtx
       return advances[hb_min (glyph - num_bearings, num_advances - num_bearings - 1)];
     }
 
+    /* Returns the default (non-variable) advances of the first
+     * get_num_decoded_advances() glyphs, decoded to native-endian on
+     * first call and shared by all fonts of the face.  Returns nullptr
+     * if the array cannot be built. */
+    const uint16_t *get_decoded_advances () const
+    {
+    retry:
+      uint16_t *advances = decoded_advances.get ();
+      if (likely (advances))
+	return advances;
+
+      /* Also protects the Null accelerator from being written to. */
+      if (unlikely (!num_glyphs || default_advance > 0xFFFFu))
+	return nullptr;
+
+      advances = (uint16_t *) hb_malloc (num_glyphs * sizeof (uint16_t));
+      if (unlikely (!advances))
+	return nullptr;
+
+      for (unsigned int i = 0; i < num_glyphs; i++)
+	advances[i] = get_advance (i);
+
+      if (unlikely (!decoded_advances.cmpexch (nullptr, advances)))
+      {
+	hb_free (advances);
+	goto retry;
+      }
+      return advances;
+    }
+    unsigned int get_num_decoded_advances () const { return num_glyphs; }
+
     unsigned int get_advance (hb_codepoint_t  glyph,
 			      hb_font_t      *font,
 			      VariationStore::cache_t *store_cache = nullptr) const
@@ -311,6 +343,8 @@ struct hmtxvmtx
 
     unsigned int default_advance;
 
+    mutable hb_atomic_ptr_t<uint16_t> decoded_advances;
+
     public:
     hb_blob_ptr_t<hmtxvmtx> table;
     hb_blob_ptr_t<HVARVVAR> var_table;
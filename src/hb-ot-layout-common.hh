@@ -68,6 +68,14 @@
 #define HB_MAX_FEATURES 750
 #endif
 
+#ifndef HB_MAX_CACHED_VAR_DELTAS
+#define HB_MAX_CACHED_VAR_DELTAS 65536
+#endif
+
+#ifndef HB_MAX_CACHED_VARIATIONS_CELLS
+#define HB_MAX_CACHED_VARIATIONS_CELLS 4096
+#endif
+
 #ifndef HB_MAX_FEATURE_INDICES
 #define HB_MAX_FEATURE_INDICES	1500
 #endif
@@ -2681,6 +2689,9 @@ struct VarRegionList
 
 struct VarData
 {
+  unsigned int get_item_count () const
+  { return itemCount; }
+
   unsigned int get_region_index_count () const
   { return regionIndices.len; }
 
@@ -2738,11 +2749,12 @@ struct VarData
   void get_region_scalars (const int *coords, unsigned int coord_count,
 			   const VarRegionList &regions,
 			   float *scalars /*OUT */,
-			   unsigned int num_scalars) const
+			   unsigned int num_scalars,
+			   VarRegionList::cache_t *cache = nullptr) const
   {
     unsigned count = hb_min (num_scalars, regionIndices.len);
     for (unsigned int i = 0; i < count; i++)
-      scalars[i] = regions.evaluate (regionIndices.arrayZ[i], coords, coord_count);
+      scalars[i] = regions.evaluate (regionIndices.arrayZ[i], coords, coord_count, cache);
     for (unsigned int i = count; i < num_scalars; i++)
       scalars[i] = 0.f;
   }
@@ -2939,9 +2951,120 @@ struct VariationStore
     return cache;
   }
 
+  /* Returns a cache with the scalars of all regions at @coords already
+   * computed.  Nothing writes to it after, so threads can share it. */
+  cache_t *create_cache (const int *coords, unsigned int coord_count) const
+  {
+    auto &r = this+regions;
+    cache_t *cache = create_cache ();
+    if (unlikely (!cache)) return nullptr;
+
+    unsigned count = r.regionCount;
+    for (unsigned i = 0; i < count; i++)
+      r.evaluate (i, coords, coord_count, cache);
+
+    return cache;
+  }
+
   static void destroy_cache (cache_t *cache) { hb_free (cache); }
 
+  /* Deltas of all items at one set of coordinates, each resolved on
+   * first use.  Safe to use from several threads at once. */
+  struct delta_cache_t
+  {
+    static delta_cache_t *create (const VariationStore &store)
+    {
+      unsigned count = store.dataSets.len;
+      unsigned total = 0;
+      for (unsigned i = 0; i < count; i++)
+      {
+	total += (&store+store.dataSets[i]).get_item_count ();
+	if (unlikely (total > HB_MAX_CACHED_VAR_DELTAS))
+	  return nullptr;
+      }
+
+      delta_cache_t *c = (delta_cache_t *) hb_calloc (1, sizeof (delta_cache_t));
+      if (unlikely (!c))
+	return nullptr;
+      c->starts.init ();
+      c->values.init ();
+      if (unlikely (!c->starts.resize (count + 1) ||
+		    !c->values.resize (total)))
+      {
+	c->destroy ();
+	return nullptr;
+      }
+
+      total = 0;
+      for (unsigned i = 0; i < count; i++)
+      {
+	c->starts.arrayZ[i] = total;
+	total += (&store+store.dataSets[i]).get_item_count ();
+      }
+      c->starts.arrayZ[count] = total;
+      for (unsigned i = 0; i < total; i++)
+	c->values.arrayZ[i].set_relaxed (UNRESOLVED);
+
+      return c;
+    }
+
+    void destroy ()
+    {
+      starts.fini ();
+      values.fini ();
+      hb_free (this);
+    }
+
+    /* Same as VariationStore::get_delta(), for the store and coordinates
+     * this was created for. */
+    float get_delta (const VariationStore &store,
+		     unsigned int index,
+		     const int *coords, unsigned int coord_count,
+		     VarRegionList::cache_t *cache = nullptr) const
+    {
+      unsigned int outer = index >> 16;
+      unsigned int inner = index & 0xFFFF;
+      if (unlikely (outer + 1 >= starts.length))
+	return 0.f;
+      unsigned int i = starts.arrayZ[outer] + inner;
+      if (unlikely (i >= starts.arrayZ[outer + 1]))
+	return 0.f;
+
+      float delta;
+      int v = values.arrayZ[i].get_relaxed ();
+      if (v != UNRESOLVED)
+      {
+	hb_memcpy (&delta, &v, sizeof (delta));
+	return delta;
+      }
+
+      delta = store.get_delta (outer, inner, coords, coord_count, cache);
+      hb_memcpy (&v, &delta, sizeof (v));
+      values.arrayZ[i].set_relaxed (v);
+      return delta;
+    }
+
+    /* A NaN; deltas never are. */
+    static constexpr int UNRESOLVED = 0x7FC0DEAD;
+
+    hb_vector_t<unsigned> starts; /* Index of the first item of each VarData. */
+    mutable hb_vector_t<hb_atomic_int_t> values; /* Float bits. */
+  };
+
+  /* Region scalars, and optionally memoized deltas, of a store at the
+   * coordinates of a font.  See get_font_cache(). */
+  typedef VarStoreFontCache font_cache_t;
+
+  /* Returns the cache of this store for the current coordinates of
+   * @font, kept in the font's @slot, or nullptr.  The cache lives until
+   * the font is destroyed or its coordinates or face change. */
+  inline const font_cache_t *get_font_cache (hb_font_t *font,
+					     hb_font_var_store_t slot,
+					     bool memoize_deltas) const;
+
   private:
+  friend struct VarStoreFontCache;
+
   float get_delta (unsigned int outer, unsigned int inner,
 		   const int *coords, unsigned int coord_count,
 		   VarRegionList::cache_t *cache = nullptr) const
@@ -3070,7 +3193,8 @@ struct VariationStore
   void get_region_scalars (unsigned int major,
 			   const int *coords, unsigned int coord_count,
 			   float *scalars /*OUT*/,
-			   unsigned int num_scalars) const
+			   unsigned int num_scalars,
+			   cache_t *cache = nullptr) const
   {
 #ifdef HB_NO_VAR
     for (unsigned i = 0; i < num_scalars; i++)
@@ -3080,7 +3204,8 @@ struct VariationStore
 
     (this+dataSets[major]).get_region_scalars (coords, coord_count,
 					       this+regions,
-					       &scalars[0], num_scalars);
+					       &scalars[0], num_scalars,
+					       cache);
   }
 
   unsigned int get_sub_table_count () const { return dataSets.len; }
@@ -3093,6 +3218,85 @@ struct VariationStore
   DEFINE_SIZE_ARRAY_SIZED (8, dataSets);
 };
 
+/* Region scalars, and optionally memoized deltas, of a VariationStore at
+ * the coordinates of a font.  Fonts keep one per store they use, in
+ * hb_font_t::var_store_caches. */
+struct VarStoreFontCache
+{
+  static VarStoreFontCache *create (const VariationStore &store,
+				    hb_font_t *font,
+				    bool memoize_deltas)
+  {
+    VarStoreFontCache *c = (VarStoreFontCache *) hb_calloc (1, sizeof (VarStoreFontCache));
+    if (unlikely (!c))
+      return nullptr;
+    c->serial = font->serial_coords;
+    c->store = &store;
+    c->region_count = (&store+store.regions).regionCount;
+    c->scalars = store.create_cache (font->coords, font->num_coords);
+    if (unlikely (!c->scalars))
+    {
+      c->destroy ();
+      return nullptr;
+    }
+    if (memoize_deltas)
+      c->deltas = VariationStore::delta_cache_t::create (store);
+    return c;
+  }
+
+  void destroy ()
+  {
+    if (deltas)
+      deltas->destroy ();
+    VariationStore::destroy_cache (scalars);
+    hb_free (this);
+  }
+
+  /* Whether this was made for @store_ at the current coordinates of
+   * @font. */
+  bool is_for (const VariationStore &store_, const hb_font_t *font) const
+  {
+    return serial == font->serial_coords &&
+	   store == &store_ &&
+	   region_count == (&store_+store_.regions).regionCount;
+  }
+
+  unsigned int serial; /* Of the font coordinates this was made for. */
+  const VariationStore *store;
+  unsigned int region_count;
+  VariationStore::cache_t *scalars; /* Complete; read-only. */
+  VariationStore::delta_cache_t *deltas; /* May be nullptr. */
+};
+
+inline const VarStoreFontCache *
+VariationStore::get_font_cache (hb_font_t *font,
+				hb_font_var_store_t slot,
+				bool memoize_deltas) const
+{
+  if (!font->num_coords || !(this+regions).regionCount)
+    return nullptr;
+
+  hb_atomic_ptr_t<VarStoreFontCache> &p = font->var_store_caches[slot];
+retry:
+  VarStoreFontCache *cache = p.get ();
+  if (likely (cache))
+    /* Changing the font frees its caches, so this one is current.  If it
+     * is for another store, as when the font funcs are for another face,
+     * this one goes uncached. */
+    return cache->is_for (*this, font) ? cache : nullptr;
+
+  VarStoreFontCache *fresh = VarStoreFontCache::create (*this, font, memoize_deltas);
+  if (unlikely (!fresh))
+    return nullptr;
+  if (unlikely (!p.cmpexch (nullptr, fresh)))
+  {
+    /* Another thread got there first; nothing has seen ours. */
+    fresh->destroy ();
+    goto retry;
+  }
+  return fresh;
+}
+
 #undef REGION_CACHE_ITEM_CACHE_INVALID
 
 /*
@@ -3118,6 +3322,12 @@ struct ConditionFormat1
     return filterRangeMinValue <= coord && coord <= filterRangeMaxValue;
   }
 
+  void collect_bounds (hb_vector_t<hb_pair_t<unsigned, int>> *bounds) const
+  {
+    bounds->push (hb_pair ((unsigned) axisIndex, (int) filterRangeMinValue));
+    bounds->push (hb_pair ((unsigned) axisIndex, (int) filterRangeMaxValue));
+  }
+
   bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -3143,6 +3353,16 @@ struct Condition
     }
   }
 
+  /* Collects the (axis, value) pairs that evaluate() compares coordinates
+   * against.  Other formats do not depend on coordinates. */
+  void collect_bounds (hb_vector_t<hb_pair_t<unsigned, int>> *bounds) const
+  {
+    switch (u.format) {
+    case 1: u.format1.collect_bounds (bounds); return;
+    default:return;
+    }
+  }
+
   template <typename context_t, typename ...Ts>
   typename context_t::return_t dispatch (context_t *c, Ts&&... ds) const
   {
@@ -3184,6 +3404,12 @@ struct ConditionSet
     return true;
   }
 
+  void collect_bounds (hb_vector_t<hb_pair_t<unsigned, int>> *bounds) const
+  {
+    for (const auto &offset : conditions)
+      (this+offset).collect_bounds (bounds);
+  }
+
   bool subset (hb_subset_context_t *c) const
   {
     TRACE_SUBSET (this);
@@ -3401,6 +3627,112 @@ struct FeatureVariations
     return false;
   }
 
+  /*
+   * index_cache_t
+   *
+   * Memoizes find_index() by the cell of the grid of condition bounds
+   * that the coordinates fall in: all coordinates in one cell satisfy the
+   * same conditions, so a slider moving within a cell hits the same entry.
+   * Cells are resolved on first use, by any thread.
+   */
+  struct index_cache_t
+  {
+    void init (const FeatureVariations &table)
+    {
+      hb_vector_t<hb_pair_t<unsigned, int>> all;
+      for (const FeatureVariationRecord &record : table.varRecords)
+	(&table+record.conditions).collect_bounds (&all);
+      if (unlikely (all.in_error () || table.varRecords.len >= 0x7FFFFFFEu))
+	return;
+      all.qsort (cmp_bound);
+
+      unsigned cell_count = 1;
+      for (unsigned i = 0; i < all.length; i++)
+      {
+	if (i && all.arrayZ[i] == all.arrayZ[i - 1])
+	  continue;
+	if (!i || all.arrayZ[i].first != all.arrayZ[i - 1].first)
+	{
+	  axes.push (axis_t {all.arrayZ[i].first, bounds.length, 0, cell_count});
+	  if (unlikely (axes.in_error ()))
+	    return;
+	}
+	axis_t &axis = axes.tail ();
+	bounds.push (all.arrayZ[i].second);
+	axis.count++;
+	/* Each bound splits the axis into below, at, and above it. */
+	if (axis.count == 1)
+	  cell_count += 2 * cell_count;
+	else
+	  cell_count += 2 * axis.stride;
+	if (cell_count > HB_MAX_CACHED_VARIATIONS_CELLS)
+	  return;
+      }
+
+      if (unlikely (!cells.resize (cell_count)))
+	cells.resize (0);
+    }
+
+    void fini ()
+    {
+      axes.fini ();
+      bounds.fini ();
+      cells.fini ();
+    }
+
+    bool find_index (const FeatureVariations &table,
+		     const int *coords, unsigned int coord_len,
+		     unsigned int *index) const
+    {
+      if (!cells.length)
+	return table.find_index (coords, coord_len, index);
+
+      unsigned cell = 0;
+      for (unsigned i = 0; i < axes.length; i++)
+      {
+	const axis_t &axis = axes.arrayZ[i];
+	int coord = axis.index < coord_len ? coords[axis.index] : 0;
+	const int *b = bounds.arrayZ + axis.start;
+	unsigned k = 0;
+	while (k < axis.count && b[k] < coord)
+	  k++;
+	cell += (2 * k + (k < axis.count && b[k] == coord)) * axis.stride;
+      }
+
+      /* Records are stored off by two, with one for none and zero for
+       * unresolved. */
+      int v = cells.arrayZ[cell].get_relaxed ();
+      if (!v)
+      {
+	table.find_index (coords, coord_len, index);
+	v = *index == NOT_FOUND_INDEX ? 1 : (int) *index + 2;
+	cells.arrayZ[cell].set_relaxed (v);
+      }
+      *index = v == 1 ? NOT_FOUND_INDEX : (unsigned) v - 2;
+      return v != 1;
+    }
+
+    private:
+    static int cmp_bound (const void *pa, const void *pb)
+    {
+      const hb_pair_t<unsigned, int> &a = * (const hb_pair_t<unsigned, int> *) pa;
+      const hb_pair_t<unsigned, int> &b = * (const hb_pair_t<unsigned, int> *) pb;
+      return a < b ? -1 : b < a ? +1 : 0;
+    }
+
+    struct axis_t
+    {
+      unsigned index; /* Axis index. */
+      unsigned start; /* Into bounds. */
+      unsigned count; /* Distinct bounds, sorted. */
+      unsigned stride; /* Of the axis in cells. */
+    };
+
+    hb_vector_t<axis_t> axes;
+    hb_vector_t<int> bounds;
+    mutable hb_vector_t<hb_atomic_int_t> cells;
+  };
+
   const Feature *find_substitute (unsigned int variations_index,
 				  unsigned int feature_index) const
   {
@@ -3564,13 +3896,15 @@ struct VariationDevice
 
   hb_position_t get_x_delta (hb_font_t *font,
 			     const VariationStore &store,
-			     VariationStore::cache_t *store_cache = nullptr) const
-  { return font->em_scalef_x (get_delta (font, store, store_cache)); }
+			     VariationStore::cache_t *store_cache = nullptr,
+			     const VariationStore::delta_cache_t *deltas = nullptr) const
+  { return font->em_scalef_x (get_delta (font, store, store_cache, deltas)); }
 
   hb_position_t get_y_delta (hb_font_t *font,
 			     const VariationStore &store,
-			     VariationStore::cache_t *store_cache = nullptr) const
-  { return font->em_scalef_y (get_delta (font, store, store_cache)); }
+			     VariationStore::cache_t *store_cache = nullptr,
+			     const VariationStore::delta_cache_t *deltas = nullptr) const
+  { return font->em_scalef_y (get_delta (font, store, store_cache, deltas)); }
 
   VariationDevice* copy (hb_serialize_context_t *c, const hb_map_t *layout_variation_idx_map) const
   {
@@ -3606,8 +3940,11 @@ struct VariationDevice
 
   float get_delta (hb_font_t *font,
 		   const VariationStore &store,
-		   VariationStore::cache_t *store_cache = nullptr) const
+		   VariationStore::cache_t *store_cache = nullptr,
+		   const VariationStore::delta_cache_t *deltas = nullptr) const
   {
+    if (deltas)
+      return deltas->get_delta (store, varIdx, font->coords, font->num_coords, store_cache);
     return store.get_delta (varIdx, font->coords, font->num_coords, (VariationStore::cache_t *) store_cache);
   }
 
@@ -3633,7 +3970,8 @@ struct Device
 {
   hb_position_t get_x_delta (hb_font_t *font,
 			     const VariationStore &store=Null (VariationStore),
-			     VariationStore::cache_t *store_cache = nullptr) const
+			     VariationStore::cache_t *store_cache = nullptr,
+			     const VariationStore::delta_cache_t *deltas = nullptr) const
   {
     switch (u.b.format)
     {
@@ -3643,7 +3981,7 @@ struct Device
 #endif
 #ifndef HB_NO_VAR
     case 0x8000:
-      return u.variation.get_x_delta (font, store, store_cache);
+      return u.variation.get_x_delta (font, store, store_cache, deltas);
 #endif
     default:
       return 0;
@@ -3651,7 +3989,8 @@ struct Device
   }
   hb_position_t get_y_delta (hb_font_t *font,
 			     const VariationStore &store=Null (VariationStore),
-			     VariationStore::cache_t *store_cache = nullptr) const
+			     VariationStore::cache_t *store_cache = nullptr,
+			     const VariationStore::delta_cache_t *deltas = nullptr) const
   {
     switch (u.b.format)
     {
@@ -3661,7 +4000,7 @@ struct Device
 #endif
 #ifndef HB_NO_VAR
     case 0x8000:
-      return u.variation.get_y_delta (font, store, store_cache);
+      return u.variation.get_y_delta (font, store, store_cache, deltas);
 #endif
     default:
       return 0;
@@ -34,6 +34,13 @@
 #include "hb-font.hh"
 
 
+/* Mark filtering sets past this many are looked up in their Coverage
+ * instead of a bitmap. */
+#ifndef HB_GDEF_MAX_CACHED_MARK_SETS
+#define HB_GDEF_MAX_CACHED_MARK_SETS 64
+#endif
+
+
 namespace OT {
 
 
@@ -422,6 +429,12 @@ struct MarkGlyphSetsFormat1
   bool covers (unsigned int set_index, hb_codepoint_t glyph_id) const
   { return (this+coverage[set_index]).get_coverage (glyph_id) != NOT_COVERED; }
 
+  unsigned int get_set_count () const { return coverage.len; }
+
+  template <typename set_t>
+  bool collect_coverage (unsigned int set_index, set_t *glyphs) const
+  { return (this+coverage[set_index]).collect_coverage (glyphs); }
+
   bool subset (hb_subset_context_t *c) const
   {
     TRACE_SUBSET (this);
@@ -475,6 +488,23 @@ struct MarkGlyphSets
     }
   }
 
+  unsigned int get_set_count () const
+  {
+    switch (u.format) {
+    case 1: return u.format1.get_set_count ();
+    default:return 0;
+    }
+  }
+
+  template <typename set_t>
+  bool collect_coverage (unsigned int set_index, set_t *glyphs) const
+  {
+    switch (u.format) {
+    case 1: return u.format1.collect_coverage (set_index, glyphs);
+    default:return false;
+    }
+  }
+
   bool subset (hb_subset_context_t *c) const
   {
     TRACE_SUBSET (this);
@@ -593,10 +623,124 @@ struct GDEF
 	hb_blob_destroy (table.get_blob ());
 	table = hb_blob_get_empty ();
       }
+
+      init_glyph_props (face);
     }
     ~accelerator_t () { table.destroy (); }
 
+    /* Same as GDEF::get_glyph_props(), but from the cache. */
+    unsigned int get_glyph_props (hb_codepoint_t glyph) const
+    {
+      if (glyph < glyph_props.length)
+	return glyph_props.arrayZ[glyph];
+      return glyph_props.length ? 0 : table->get_glyph_props (glyph);
+    }
+
+    bool mark_set_covers (unsigned int set_index, hb_codepoint_t glyph_id) const
+    {
+      const uint64_t *bits = get_mark_set_bits (set_index);
+      if (bits)
+	return mark_set_bits_cover (bits, glyph_id);
+      return table->mark_set_covers (set_index, glyph_id);
+    }
+
+    /* Returns the bitmap of the glyphs in a mark filtering set, for use
+     * with mark_set_bits_cover(), or nullptr if the set is not cached. */
+    const uint64_t *get_mark_set_bits (unsigned int set_index) const
+    {
+      if (set_index >= num_mark_sets)
+	return nullptr;
+      return mark_set_bits.arrayZ + set_index * mark_set_stride;
+    }
+
+    /* Marks all have cached props, so glyphs past them are in no set. */
+    bool mark_set_bits_cover (const uint64_t *bits, hb_codepoint_t glyph_id) const
+    {
+      return glyph_id < glyph_props.length &&
+	     (bits[glyph_id / 64] >> (glyph_id % 64)) & 1;
+    }
+
+#ifndef HB_NO_VAR
+    /* Returns the cache of the VariationStore for the current coordinates
+     * of @font, or nullptr. */
+    const VariationStore::font_cache_t *
+    get_var_cache (hb_font_t *font) const
+    {
+      if (!table->has_var_store ())
+	return nullptr;
+
+      return table->get_var_store ().get_font_cache (font, HB_FONT_VAR_STORE_GDEF, true);
+    }
+#endif
+
     hb_blob_ptr_t<GDEF> table;
+
+    private:
+
+    /* Caches the props of all glyphs up to the last one with a glyph
+     * class; the ones after it have none.  Without a cache, props come
+     * from the table. */
+    void init_glyph_props (hb_face_t *face)
+    {
+      if (!table->has_glyph_classes ())
+	return;
+
+      hb_set_t glyphs;
+      (table+table->glyphClassDef).collect_coverage (&glyphs);
+      if (unlikely (glyphs.in_error () || glyphs.is_empty ()))
+	return;
+      /* Classes may reach past the glyph count; only give up on ones far
+       * past it, so a broken font can't make the cache huge. */
+      unsigned count = glyphs.get_max () + 1;
+      if (unlikely (count > hb_max (face->get_num_glyphs (), 0x10000u) ||
+		    !glyph_props.resize (count)))
+	return;
+
+      for (unsigned i = 0; i < count; i++)
+	glyph_props.arrayZ[i] = table->get_glyph_props (i);
+
+      init_mark_sets ();
+    }
+
+    /* Turns the first few mark filtering sets into bitmaps over the
+     * glyphs with cached props. */
+    void init_mark_sets ()
+    {
+      if (!table->has_mark_sets ())
+	return;
+
+      const MarkGlyphSets &mark_sets = table+table->markGlyphSetsDef;
+      unsigned count = hb_min (mark_sets.get_set_count (), (unsigned) HB_GDEF_MAX_CACHED_MARK_SETS);
+      unsigned stride = (glyph_props.length + 63) / 64;
+      if (unlikely (!mark_set_bits.resize (count * stride)))
+	return;
+
+      for (unsigned i = 0; i < count; i++)
+      {
+	hb_set_t glyphs;
+	mark_sets.collect_coverage (i, &glyphs);
+	if (unlikely (glyphs.in_error ()))
+	{
+	  mark_set_bits.fini ();
+	  return;
+	}
+	uint64_t *bits = mark_set_bits.arrayZ + i * stride;
+	for (hb_codepoint_t g : glyphs)
+	{
+	  if (g >= glyph_props.length)
+	    break;
+	  bits[g / 64] |= (uint64_t) 1 << (g % 64);
+	}
+      }
+
+      num_mark_sets = count;
+      mark_set_stride = stride;
+    }
+
+    hb_vector_t<uint16_t> glyph_props;
+    hb_vector_t<uint64_t> mark_set_bits;
+    unsigned int num_mark_sets = 0;
+    unsigned int mark_set_stride = 0;
   };
 
   unsigned int get_size () const
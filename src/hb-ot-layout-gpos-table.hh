@@ -51,6 +51,10 @@ enum attach_type_t {
   /* Each attachment should be either a mark or a cursive; can't be both. */
   ATTACH_TYPE_MARK	= 0X01,
   ATTACH_TYPE_CURSIVE	= 0X02,
+
+  /* Used by propagate_attachment_offsets(), for glyphs on the chain it
+   * is walking. */
+  ATTACH_TYPE_PENDING	= 0X80,
 };
 
 
@@ -147,28 +151,65 @@ struct ValueFormat : HBUINT16
 
     const VariationStore &store = c->var_store;
     auto *cache = c->var_store_cache;
+    auto *deltas = c->var_deltas;
 
     /* pixel -> fractional pixel */
     if (format & xPlaDevice) {
-      if (use_x_device) glyph_pos.x_offset  += (base + get_device (values, &ret)).get_x_delta (font, store, cache);
+      if (use_x_device) glyph_pos.x_offset  += (base + get_device (values, &ret)).get_x_delta (font, store, cache, deltas);
       values++;
     }
     if (format & yPlaDevice) {
-      if (use_y_device) glyph_pos.y_offset  += (base + get_device (values, &ret)).get_y_delta (font, store, cache);
+      if (use_y_device) glyph_pos.y_offset  += (base + get_device (values, &ret)).get_y_delta (font, store, cache, deltas);
       values++;
     }
     if (format & xAdvDevice) {
-      if (horizontal && use_x_device) glyph_pos.x_advance += (base + get_device (values, &ret)).get_x_delta (font, store, cache);
+      if (horizontal && use_x_device) glyph_pos.x_advance += (base + get_device (values, &ret)).get_x_delta (font, store, cache, deltas);
       values++;
     }
     if (format & yAdvDevice) {
       /* y_advance values grow downward but font-space grows upward, hence negation */
-      if (!horizontal && use_y_device) glyph_pos.y_advance -= (base + get_device (values, &ret)).get_y_delta (font, store, cache);
+      if (!horizontal && use_y_device) glyph_pos.y_advance -= (base + get_device (values, &ret)).get_y_delta (font, store, cache, deltas);
       values++;
     }
     return ret;
   }
 
+  /* Decodes the placement and advance values, zero where absent, for
+   * apply_flat_value().  Device tables are left out. */
+  void decode_values (const Value *values, int16_t out[4]) const
+  {
+    unsigned int format = *this;
+    for (unsigned i = 0; i < 4; i++)
+      out[i] = (format & (xPlacement << i)) ? (int16_t) get_short (values++) : 0;
+  }
+
+  /* Like apply_value(), with values decoded by decode_values(), for fonts
+   * using no Device tables. */
+  static bool apply_flat_value (hb_ot_apply_context_t *c,
+				const int16_t          values[4],
+				hb_glyph_position_t   &glyph_pos)
+  {
+    bool ret = false;
+    hb_font_t *font = c->font;
+    bool horizontal =
+#ifndef HB_NO_VERTICAL
+      HB_DIRECTION_IS_HORIZONTAL (c->direction)
+#else
+      true
+#endif
+      ;
+
+    if (values[0]) { glyph_pos.x_offset += font->em_scale_x (values[0]); ret = true; }
+    if (values[1]) { glyph_pos.y_offset += font->em_scale_y (values[1]); ret = true; }
+    if (likely (horizontal))
+    {
+      if (values[2]) { glyph_pos.x_advance += font->em_scale_x (values[2]); ret = true; }
+    }
+    /* y_advance values grow downward but font-space grows upward, hence negation */
+    else if (values[3]) { glyph_pos.y_advance -= font->em_scale_y (values[3]); ret = true; }
+    return ret;
+  }
+
   unsigned int get_effective_format (const Value *values) const
   {
     unsigned int format = *this;
@@ -466,9 +507,9 @@ struct AnchorFormat3
     *y = font->em_fscale_y (yCoordinate);
 
     if (font->x_ppem || font->num_coords)
-      *x += (this+xDeviceTable).get_x_delta (font, c->var_store, c->var_store_cache);
+      *x += (this+xDeviceTable).get_x_delta (font, c->var_store, c->var_store_cache, c->var_deltas);
     if (font->y_ppem || font->num_coords)
-      *y += (this+yDeviceTable).get_y_delta (font, c->var_store, c->var_store_cache);
+      *y += (this+yDeviceTable).get_y_delta (font, c->var_store, c->var_store_cache, c->var_deltas);
   }
 
   bool sanitize (hb_sanitize_context_t *c) const
@@ -1211,6 +1252,35 @@ struct PairSet
     }
   }
 
+  /* Adds the decoded values of the pairs, for the first glyph of coverage
+   * index first_index.  Fails if the records are not strictly sorted by
+   * second glyph, since apply() would not find some of them. */
+  bool compile_pairs (unsigned int first_index,
+		      const ValueFormat *valueFormats,
+		      hb_flat_pairs_t *pairs) const
+  {
+    unsigned int len1 = valueFormats[0].get_len ();
+    unsigned int len2 = valueFormats[1].get_len ();
+    unsigned int record_size = HBUINT16::static_size * (1 + len1 + len2);
+
+    const PairValueRecord *record = &firstPairValueRecord;
+    unsigned int count = len;
+    hb_codepoint_t last = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      if (i && record->secondGlyph <= last)
+	return false;
+      last = record->secondGlyph;
+
+      hb_flat_pair_value_t value;
+      valueFormats[0].decode_values (&record->values[0], value.values[0]);
+      valueFormats[1].decode_values (&record->values[len1], value.values[1]);
+      pairs->pairs.set (hb_flat_pairs_t::pair_key (first_index, record->secondGlyph), value);
+      record = &StructAtOffset<const PairValueRecord> (record, record_size);
+    }
+    return true;
+  }
+
   bool apply (hb_ot_apply_context_t *c,
 	      const ValueFormat *valueFormats,
 	      unsigned int pos) const
@@ -1355,11 +1425,40 @@ struct PairPosFormat1
 
   const Coverage &get_coverage () const { return this+coverage; }
 
+  /* Decodes the values of all pairs, for the lookup accelerator.  Pair
+   * sets that are not strictly sorted leave the subtable as it is. */
+  bool compile_pairs (hb_flat_pairs_t *pairs, unsigned *budget) const
+  {
+    typedef hb_hashmap_t<uint32_t, hb_flat_pair_value_t>::item_t item_t;
+
+    unsigned int count = 0;
+    for (const Offset16To<PairSet> &offset : pairSet)
+      count += (this+offset).len;
+    if (!count ||
+	count > *budget / (2 * sizeof (item_t)) ||
+	unlikely (!pairs->pairs.resize (count)))
+      return false;
+
+    for (unsigned int i = 0; i < pairSet.len; i++)
+      if (!(this+pairSet[i]).compile_pairs (i, valueFormat, pairs))
+	return false;
+
+    unsigned int size = (pairs->pairs.mask + 1) * sizeof (item_t);
+    if (unlikely (pairs->pairs.in_error ()) || size > *budget)
+      return false;
+    *budget -= size;
+    pairs->has_devices = valueFormat[0].has_device () || valueFormat[1].has_device ();
+    return true;
+  }
+
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
     hb_buffer_t *buffer = c->buffer;
-    unsigned int index = (this+coverage).get_coverage  (buffer->cur().codepoint);
+    const hb_flat_subtable_t *flat = c->get_flat_tables (this);
+    unsigned int index = flat
+		       ? flat->coverage->get (buffer->cur().codepoint)
+		       : (this+coverage).get_coverage  (buffer->cur().codepoint);
     if (likely (index == NOT_COVERED)) return_trace (false);
 
     hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
@@ -1371,9 +1470,34 @@ struct PairPosFormat1
       return_trace (false);
     }
 
+    if (flat && flat->pairs->applies_to (c->font))
+      return_trace (apply_flat (c, flat->pairs->get_pair (index, buffer->info[skippy_iter.idx].codepoint), skippy_iter.idx));
+
     return_trace ((this+pairSet[index]).apply (c, valueFormat, skippy_iter.idx));
   }
 
+  /* Like PairSet::apply(), with the decoded values of the pair, if any. */
+  bool apply_flat (hb_ot_apply_context_t *c,
+		   const hb_flat_pair_value_t *value,
+		   unsigned int pos) const
+  {
+    TRACE_APPLY (this);
+    hb_buffer_t *buffer = c->buffer;
+    if (value)
+    {
+      bool applied_first = ValueFormat::apply_flat_value (c, value->values[0], buffer->cur_pos());
+      bool applied_second = ValueFormat::apply_flat_value (c, value->values[1], buffer->pos[pos]);
+      if (applied_first || applied_second)
+	buffer->unsafe_to_break (buffer->idx, pos + 1);
+      if (valueFormat[1].get_len ())
+	pos++;
+      buffer->idx = pos;
+      return_trace (true);
+    }
+    buffer->unsafe_to_concat (buffer->idx, pos + 1);
+    return_trace (false);
+  }
+
   bool subset (hb_subset_context_t *c) const
   {
     TRACE_SUBSET (this);
@@ -1552,12 +1676,46 @@ struct PairPosFormat2
   }
 
   const Coverage &get_coverage () const { return this+coverage; }
+  bool get_class_defs (const ClassDef **class_defs) const
+  {
+    class_defs[0] = &(this+classDef1);
+    class_defs[1] = &(this+classDef2);
+    return true;
+  }
+
+  /* Decodes the values of the class pair matrix, for the lookup
+   * accelerator. */
+  bool compile_pairs (hb_flat_pairs_t *pairs, unsigned *budget) const
+  {
+    unsigned int len1 = valueFormat1.get_len ();
+    unsigned int len2 = valueFormat2.get_len ();
+    unsigned int record_len = len1 + len2;
+    unsigned int count = (unsigned int) class1Count * (unsigned int) class2Count;
+    if (!count ||
+	count > *budget / sizeof (hb_flat_pair_value_t) ||
+	unlikely (!pairs->values.resize (count)))
+      return false;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+      const Value *v = &values[record_len * i];
+      valueFormat1.decode_values (v, pairs->values.arrayZ[i].values[0]);
+      valueFormat2.decode_values (v + len1, pairs->values.arrayZ[i].values[1]);
+    }
+
+    *budget -= count * sizeof (hb_flat_pair_value_t);
+    pairs->has_devices = valueFormat1.has_device () || valueFormat2.has_device ();
+    return true;
+  }
 
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
     hb_buffer_t *buffer = c->buffer;
-    unsigned int index = (this+coverage).get_coverage  (buffer->cur().codepoint);
+    const hb_flat_subtable_t *flat = c->get_flat_tables (this);
+    unsigned int index = flat
+		       ? flat->coverage->get (buffer->cur().codepoint)
+		       : (this+coverage).get_coverage  (buffer->cur().codepoint);
     if (likely (index == NOT_COVERED)) return_trace (false);
 
     hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
@@ -1573,8 +1731,17 @@ struct PairPosFormat2
     unsigned int len2 = valueFormat2.get_len ();
     unsigned int record_len = len1 + len2;
 
-    unsigned int klass1 = (this+classDef1).get_class (buffer->cur().codepoint);
-    unsigned int klass2 = (this+classDef2).get_class (buffer->info[skippy_iter.idx].codepoint);
+    unsigned int klass1, klass2;
+    if (flat)
+    {
+      klass1 = flat->class_defs[0]->get (buffer->cur().codepoint);
+      klass2 = flat->class_defs[1]->get (buffer->info[skippy_iter.idx].codepoint);
+    }
+    else
+    {
+      klass1 = (this+classDef1).get_class (buffer->cur().codepoint);
+      klass2 = (this+classDef2).get_class (buffer->info[skippy_iter.idx].codepoint);
+    }
     if (unlikely (klass1 >= class1Count || klass2 >= class2Count))
     {
       buffer->unsafe_to_concat (buffer->idx, skippy_iter.idx + 1);
@@ -1582,6 +1749,9 @@ struct PairPosFormat2
     }
 
     const Value *v = &values[record_len * (klass1 * class2Count + klass2)];
+    const hb_flat_pair_value_t *flat_value = flat && flat->pairs && flat->pairs->applies_to (c->font)
+					   ? &flat->pairs->values.arrayZ[klass1 * class2Count + klass2]
+					   : nullptr;
 
     bool applied_first = false, applied_second = false;
 
@@ -1648,8 +1818,16 @@ struct PairPosFormat2
     bail:
 
 
-    applied_first = valueFormat1.apply_value (c, this, v, buffer->cur_pos());
-    applied_second = valueFormat2.apply_value (c, this, v + len1, buffer->pos[skippy_iter.idx]);
+    if (flat_value)
+    {
+      applied_first = ValueFormat::apply_flat_value (c, flat_value->values[0], buffer->cur_pos());
+      applied_second = ValueFormat::apply_flat_value (c, flat_value->values[1], buffer->pos[skippy_iter.idx]);
+    }
+    else
+    {
+      applied_first = valueFormat1.apply_value (c, this, v, buffer->cur_pos());
+      applied_second = valueFormat2.apply_value (c, this, v + len1, buffer->pos[skippy_iter.idx]);
+    }
 
     success:
     if (applied_first || applied_second)
@@ -2892,6 +3070,11 @@ struct PosLookup : Lookup
     return false;
   }
 
+  bool is_inplace () const
+  {
+    return true;
+  }
+
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
@@ -3021,26 +3204,74 @@ reverse_cursive_minor_offset (hb_glyph_position_t *pos, unsigned int i, hb_direc
   pos[j].attach_chain() = -chain;
   pos[j].attach_type() = type;
 }
-static void
-propagate_attachment_offsets (hb_glyph_position_t *pos,
-			      unsigned int len,
-			      unsigned int i,
-			      hb_direction_t direction)
+#ifndef HB_ATTACHMENT_ADVANCES_MIN_DISTANCE
+#define HB_ATTACHMENT_ADVANCES_MIN_DISTANCE 16
+#endif
+
+/* Sums of the advances of the glyphs before each glyph, such that marks
+ * can find the distance to their base in constant time.  The sums are
+ * made in the scratch space of the buffer, the first time a mark is far
+ * from its base; until then, or if they could not be allocated, the
+ * advances are summed each time instead. */
+struct hb_attachment_advances_t
 {
-  /* Adjusts offsets of attached glyphs (both cursive and mark) to accumulate
-   * offset of glyph they are attached to. */
-  int chain = pos[i].attach_chain(), type = pos[i].attach_type();
-  if (likely (!chain))
-    return;
+  hb_attachment_advances_t (hb_buffer_t *buffer_) : buffer (buffer_) {}
 
-  pos[i].attach_chain() = 0;
+  /* Adds the advances of the glyphs in [start, end) to *x and *y. */
+  void add (const hb_glyph_position_t *pos,
+	    unsigned int start, unsigned int end,
+	    hb_position_t *x, hb_position_t *y)
+  {
+    if (unlikely (!sums && !tried && end - start > HB_ATTACHMENT_ADVANCES_MIN_DISTANCE))
+      sum (pos);
+    if (sums)
+    {
+      *x += (hb_position_t) (sums[2 * end] - sums[2 * start]);
+      *y += (hb_position_t) (sums[2 * end + 1] - sums[2 * start + 1]);
+      return;
+    }
+    for (unsigned int k = start; k < end; k++)
+    {
+      *x += pos[k].x_advance;
+      *y += pos[k].y_advance;
+    }
+  }
 
-  unsigned int j = (int) i + chain;
+  private:
+  void sum (const hb_glyph_position_t *pos)
+  {
+    tried = true;
+    unsigned int len = buffer->len;
+    if (unlikely (hb_unsigned_mul_overflows (len + 1, 2 * sizeof (int64_t)) ||
+		  !buffer->scratch_sums.resize (2 * (len + 1))))
+    {
+      buffer->scratch_sums.fini ();
+      return;
+    }
+    sums = buffer->scratch_sums.arrayZ;
+    sums[0] = sums[1] = 0;
+    for (unsigned int i = 0; i < len; i++)
+    {
+      sums[2 * i + 2] = sums[2 * i] + pos[i].x_advance;
+      sums[2 * i + 3] = sums[2 * i + 1] + pos[i].y_advance;
+    }
+  }
 
-  if (unlikely (j >= len))
-    return;
+  hb_buffer_t *buffer;
+  int64_t *sums = nullptr;
+  bool tried = false;
+};
 
-  propagate_attachment_offsets (pos, len, j, direction);
+/* Adjusts the offset of glyph i, attached to glyph j, to accumulate the
+ * offset of glyph j. */
+static void
+propagate_attachment_offset (hb_glyph_position_t *pos,
+			     unsigned int i,
+			     unsigned int j,
+			     hb_direction_t direction,
+			     hb_attachment_advances_t &advances)
+{
+  unsigned int type = pos[i].attach_type();
 
   assert (!!(type & ATTACH_TYPE_MARK) ^ !!(type & ATTACH_TYPE_CURSIVE));
 
@@ -3058,15 +3289,63 @@ propagate_attachment_offsets (hb_glyph_position_t *pos,
 
     assert (j < i);
     if (HB_DIRECTION_IS_FORWARD (direction))
-      for (unsigned int k = j; k < i; k++) {
-	pos[i].x_offset -= pos[k].x_advance;
-	pos[i].y_offset -= pos[k].y_advance;
-      }
+    {
+      hb_position_t x = 0, y = 0;
+      advances.add (pos, j, i, &x, &y);
+      pos[i].x_offset -= x;
+      pos[i].y_offset -= y;
+    }
     else
-      for (unsigned int k = j + 1; k < i + 1; k++) {
-	pos[i].x_offset += pos[k].x_advance;
-	pos[i].y_offset += pos[k].y_advance;
-      }
+      advances.add (pos, j + 1, i + 1, &pos[i].x_offset, &pos[i].y_offset);
+  }
+}
+
+static void
+propagate_attachment_offsets (hb_glyph_position_t *pos,
+			      unsigned int len,
+			      unsigned int i,
+			      hb_direction_t direction,
+			      hb_attachment_advances_t &advances)
+{
+  /* Adjusts offsets of attached glyphs (both cursive and mark) to accumulate
+   * offset of glyph they are attached to.
+   *
+   * Walks up from glyph i to the end of its chain of attachments, turning
+   * attach_chain() around to point back down as it goes; then walks back
+   * down adjusting the offsets.  Glyphs done are left attached to nothing,
+   * so each glyph is adjusted once, and the walk ends early at them. */
+  if (likely (!pos[i].attach_chain()))
+    return;
+
+  unsigned int j = i;
+  int back = 0;
+  for (;;)
+  {
+    int chain = pos[j].attach_chain();
+    if (!chain || (pos[j].attach_type() & ATTACH_TYPE_PENDING))
+      break;
+
+    unsigned int next = (int) j + chain;
+    if (unlikely (next >= len))
+    {
+      pos[j].attach_chain() = 0;
+      break;
+    }
+
+    pos[j].attach_chain() = back;
+    pos[j].attach_type() |= ATTACH_TYPE_PENDING;
+    back = -chain;
+    j = next;
+  }
+
+  while (back)
+  {
+    unsigned int k = (int) j + back;
+    back = pos[k].attach_chain();
+    pos[k].attach_chain() = 0;
+    pos[k].attach_type() &= ~ATTACH_TYPE_PENDING;
+    propagate_attachment_offset (pos, k, j, direction, advances);
+    j = k;
   }
 }
 
@@ -3095,8 +3374,11 @@ GPOS::position_finish_offsets (hb_font_t *font, hb_buffer_t *buffer)
 
   /* Handle attachments */
   if (buffer->scratch_flags & HB_BUFFER_SCRATCH_FLAG_HAS_GPOS_ATTACHMENT)
+  {
+    hb_attachment_advances_t advances (buffer);
     for (unsigned i = 0; i < len; i++)
-      propagate_attachment_offsets (pos, len, i, direction);
+      propagate_attachment_offsets (pos, len, i, direction, advances);
+  }
 
   if (unlikely (font->slant))
   {
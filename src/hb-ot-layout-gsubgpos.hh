@@ -36,6 +36,7 @@
 #include "hb-ot-map.hh"
 #include "hb-ot-layout-common.hh"
 #include "hb-ot-layout-gdef-table.hh"
+#include "hb-ot-layout-snapshot.hh"
 
 
 namespace OT {
@@ -395,6 +396,178 @@ struct hb_collect_coverage_context_t :
 };
 
 
+/* Native-endian, direct-index copy of a Coverage or ClassDef table, over
+ * the range of glyphs it maps.  Answers from the table itself if it was
+ * not flattened. */
+template <typename Table>
+struct hb_flat_table_t
+{
+  void init (const Table &table_)
+  {
+    table = &table_;
+    first = 0;
+    values.init ();
+  }
+  void fini () { values.fini (); }
+
+  /* Flattens the table, if that fits in *budget bytes, which are then
+   * deducted from it. */
+  void flatten (unsigned *budget)
+  {
+    hb_set_t glyphs;
+    table->collect_coverage (&glyphs);
+    if (unlikely (glyphs.in_error () || glyphs.is_empty ()))
+      return;
+
+    hb_codepoint_t last = glyphs.get_max ();
+    first = glyphs.get_min ();
+    unsigned count = last - first + 1;
+    if (count * sizeof (uint16_t) > *budget ||
+	unlikely (!values.resize (count)))
+      return;
+
+    /* Values are stored offset by the sentinel, such that it maps to 0. */
+    for (unsigned i = 0; i < count; i++)
+    {
+      unsigned v = table->get (first + i) - Table::SENTINEL;
+      if (unlikely (v > 0xFFFFu))
+      {
+	values.fini ();
+	return;
+      }
+      values.arrayZ[i] = v;
+    }
+    *budget -= count * sizeof (uint16_t);
+  }
+
+  unsigned get (hb_codepoint_t g) const
+  {
+    if (unlikely (!values.length))
+      return table->get (g);
+    unsigned i = g - first;
+    return (i < values.length ? values.arrayZ[i] : 0) + Table::SENTINEL;
+  }
+
+  const Table *table;
+  hb_codepoint_t first;
+  hb_vector_t<uint16_t> values;
+};
+
+/* Values of a glyph pair of a PairPos subtable, decoded to native-endian
+ * font units: the x and y placement and advance of either glyph. */
+struct hb_flat_pair_value_t
+{
+  int16_t values[2][4];
+};
+
+/* Decoded values of a PairPos subtable, as built by its compile_pairs():
+ * the class pair matrix of format 2, or the pairs of format 1 hashed by
+ * coverage index of the first glyph and the second glyph.  Device tables
+ * are left out. */
+struct hb_flat_pairs_t
+{
+  void init ()
+  {
+    values.init ();
+    pairs.init ();
+    has_devices = false;
+  }
+  void fini ()
+  {
+    values.fini ();
+    pairs.fini ();
+  }
+
+  /* Whether the decoded values are all there is to apply with font. */
+  bool applies_to (const hb_font_t *font) const
+  { return !has_devices || !(font->x_ppem || font->y_ppem || font->num_coords); }
+
+  static uint32_t pair_key (unsigned first_index, hb_codepoint_t second)
+  { return (first_index << 16) | second; }
+
+  const hb_flat_pair_value_t *get_pair (unsigned first_index, hb_codepoint_t second) const
+  {
+    const hb_flat_pair_value_t *value;
+    if (unlikely (second > 0xFFFFu) || !pairs.has (pair_key (first_index, second), &value))
+      return nullptr;
+    return value;
+  }
+
+  hb_vector_t<hb_flat_pair_value_t> values;
+  hb_hashmap_t<uint32_t, hb_flat_pair_value_t> pairs;
+  bool has_devices;
+};
+
+/* Trie over the component glyphs of the ligatures of a
+ * LigatureSubstFormat1 subtable, one per LigatureSet, as built by its
+ * compile_trie(). */
+struct hb_ligature_trie_t
+{
+  static constexpr unsigned NOT_FOUND = (unsigned) -1;
+
+  struct node_t
+  {
+    unsigned first_edge; /* Children, ordered by glyph. */
+    unsigned num_edges;
+    unsigned first_ligature; /* Ligatures ending here, in set order. */
+    unsigned num_ligatures;
+  };
+
+  struct edge_t
+  {
+    int cmp (hb_codepoint_t g) const
+    { return g < glyph ? -1 : g > glyph ? 1 : 0; }
+
+    hb_codepoint_t glyph;
+    unsigned node;
+  };
+
+  void init ()
+  {
+    roots.init ();
+    nodes.init ();
+    edges.init ();
+    ligatures.init ();
+  }
+  void fini ()
+  {
+    roots.fini ();
+    nodes.fini ();
+    edges.fini ();
+    ligatures.fini ();
+  }
+
+  bool in_error () const
+  { return roots.in_error () || nodes.in_error () || edges.in_error () || ligatures.in_error (); }
+
+  /* Root node of the set, or NOT_FOUND if the set has no trie. */
+  unsigned get_root (unsigned set_index) const
+  { return set_index < roots.length ? roots.arrayZ[set_index] : NOT_FOUND; }
+
+  unsigned get_child (const node_t &node, hb_codepoint_t glyph) const
+  {
+    const edge_t *edge = hb_bsearch (glyph, edges.arrayZ + node.first_edge, node.num_edges);
+    return edge ? edge->node : NOT_FOUND;
+  }
+
+  hb_vector_t<unsigned> roots;
+  hb_vector_t<node_t> nodes;
+  hb_vector_t<edge_t> edges;
+  hb_vector_t<unsigned> ligatures;
+};
+
+/* Flattened tables of one subtable, as found by the subtable through
+ * hb_ot_apply_context_t::get_flat_tables(). */
+struct hb_flat_subtable_t
+{
+  const void *subtable;
+  const hb_flat_table_t<Coverage> *coverage;
+  const hb_flat_table_t<ClassDef> *class_defs[3];
+  const hb_flat_pairs_t *pairs;
+  /* Built by the subtable on first use. */
+  hb_atomic_ptr_t<hb_ligature_trie_t> ligature_trie;
+};
+
 struct hb_ot_apply_context_t :
        hb_dispatch_context_t<hb_ot_apply_context_t, bool, HB_DEBUG_APPLY>
 {
@@ -402,6 +575,7 @@ struct hb_ot_apply_context_t :
   {
     matcher_t () :
 	     lookup_props (0),
+	     mark_set_bits (nullptr),
 	     mask (-1),
 	     ignore_zwnj (false),
 	     ignore_zwj (false),
@@ -414,7 +588,12 @@ struct hb_ot_apply_context_t :
 
     void set_ignore_zwnj (bool ignore_zwnj_) { ignore_zwnj = ignore_zwnj_; }
     void set_ignore_zwj (bool ignore_zwj_) { ignore_zwj = ignore_zwj_; }
-    void set_lookup_props (unsigned int lookup_props_) { lookup_props = lookup_props_; }
+    void set_lookup_props (const hb_ot_apply_context_t *c,
+			   unsigned int lookup_props_)
+    {
+      lookup_props = lookup_props_;
+      mark_set_bits = c->get_mark_set_bits (lookup_props);
+    }
     void set_mask (hb_mask_t mask_) { mask = mask_; }
     void set_per_syllable (bool per_syllable_) { per_syllable = per_syllable_; }
     void set_syllable (uint8_t syllable_)  { syllable = per_syllable ? syllable_ : 0; }
@@ -450,7 +629,7 @@ struct hb_ot_apply_context_t :
     may_skip_t may_skip (const hb_ot_apply_context_t *c,
 			 const hb_glyph_info_t       &info) const
     {
-      if (!c->check_glyph_property (&info, lookup_props))
+      if (!c->check_glyph_property (&info, lookup_props, mark_set_bits))
 	return SKIP_YES;
 
       if (unlikely (_hb_glyph_info_is_default_ignorable_and_not_hidden (&info) &&
@@ -463,6 +642,7 @@ struct hb_ot_apply_context_t :
 
     protected:
     unsigned int lookup_props;
+    const uint64_t *mark_set_bits; /* Of the mark filtering set in lookup_props. */
     hb_mask_t mask;
     bool ignore_zwnj;
     bool ignore_zwj;
@@ -479,7 +659,7 @@ struct hb_ot_apply_context_t :
       c = c_;
       match_glyph_data = nullptr;
       matcher.set_match_func (nullptr, nullptr);
-      matcher.set_lookup_props (c->lookup_props);
+      matcher.set_lookup_props (c, c->lookup_props);
       /* Ignore ZWNJ if we are matching GPOS, or matching GSUB context and asked to. */
       matcher.set_ignore_zwnj (c->table_index == 1 || (context_match && c->auto_zwnj));
       /* Ignore ZWJ if we are matching context, or asked to. */
@@ -489,7 +669,7 @@ struct hb_ot_apply_context_t :
     }
     void set_lookup_props (unsigned int lookup_props)
     {
-      matcher.set_lookup_props (lookup_props);
+      matcher.set_lookup_props (c, lookup_props);
     }
     void set_match_func (matcher_t::match_func_t match_func_,
 			 const void *match_data_,
@@ -624,13 +804,17 @@ struct hb_ot_apply_context_t :
   hb_buffer_t *buffer;
   recurse_func_t recurse_func = nullptr;
   const GDEF &gdef;
+  const GDEF::accelerator_t &gdef_accel;
   const VariationStore &var_store;
-  VariationStore::cache_t *var_store_cache;
+  VariationStore::cache_t *var_store_cache = nullptr;
+  /* Deltas memoized for the font's coordinates, across calls. */
+  const VariationStore::delta_cache_t *var_deltas = nullptr;
 
   hb_direction_t direction;
   hb_mask_t lookup_mask = 1;
   unsigned int lookup_index = (unsigned) -1;
   unsigned int lookup_props = 0;
+  const uint64_t *lookup_mark_set_bits = nullptr; /* See get_mark_set_bits(). */
   unsigned int nesting_level_left = HB_MAX_NESTING_LEVEL;
 
   bool has_glyph_classes;
@@ -640,6 +824,13 @@ struct hb_ot_apply_context_t :
   bool random = false;
   uint32_t random_state = 1;
 
+  /* Set by the lookup accelerator for the subtable being applied. */
+  const hb_flat_subtable_t *flat_subtable = nullptr;
+
+  private:
+  VariationStore::cache_t *var_store_cache_owned = nullptr;
+
+  public:
   hb_ot_apply_context_t (unsigned int table_index_,
 			 hb_font_t *font_,
 			 hb_buffer_t *buffer_) :
@@ -652,22 +843,37 @@ struct hb_ot_apply_context_t :
 			      Null (GDEF)
 #endif
 			     ),
-			var_store (gdef.get_var_store ()),
-			var_store_cache (
-#ifndef HB_NO_VAR
-					 table_index == 1 && font->num_coords ? var_store.create_cache () : nullptr
+			gdef_accel (
+#ifndef HB_NO_OT_LAYOUT
+				    *face->table.GDEF
 #else
-					 nullptr
+				    Null (GDEF::accelerator_t)
 #endif
-					),
+				   ),
+			var_store (gdef.get_var_store ()),
 			direction (buffer_->props.direction),
 			has_glyph_classes (gdef.has_glyph_classes ())
-  { init_iters (); }
+  {
+#ifndef HB_NO_VAR
+    if (table_index == 1 && font->num_coords)
+    {
+      const VariationStore::font_cache_t *var_cache = gdef_accel.get_var_cache (font);
+      if (var_cache)
+      {
+	var_store_cache = var_cache->scalars;
+	var_deltas = var_cache->deltas;
+      }
+      else
+	var_store_cache = var_store_cache_owned = var_store.create_cache ();
+    }
+#endif
+    init_iters ();
+  }
 
   ~hb_ot_apply_context_t ()
   {
 #ifndef HB_NO_VAR
-    VariationStore::destroy_cache (var_store_cache);
+    VariationStore::destroy_cache (var_store_cache_owned);
 #endif
   }
 
@@ -684,7 +890,18 @@ struct hb_ot_apply_context_t :
   void set_random (bool random_) { random = random_; }
   void set_recurse_func (recurse_func_t func) { recurse_func = func; }
   void set_lookup_index (unsigned int lookup_index_) { lookup_index = lookup_index_; }
-  void set_lookup_props (unsigned int lookup_props_) { lookup_props = lookup_props_; init_iters (); }
+  void set_lookup_props (unsigned int lookup_props_)
+  {
+    lookup_props = lookup_props_;
+    lookup_mark_set_bits = get_mark_set_bits (lookup_props);
+    init_iters ();
+  }
+
+  /* Returns the flattened tables of subtable, if any. */
+  const hb_flat_subtable_t *get_flat_tables (const void *subtable) const
+  {
+    return flat_subtable && flat_subtable->subtable == subtable ? flat_subtable : nullptr;
+  }
 
   uint32_t random_number ()
   {
@@ -693,15 +910,27 @@ struct hb_ot_apply_context_t :
     return random_state;
   }
 
+  /* Returns the bitmap of the mark filtering set used by match_props,
+   * if any, to pass to check_glyph_property(). */
+  const uint64_t *get_mark_set_bits (unsigned int match_props) const
+  {
+    if (!(match_props & LookupFlag::UseMarkFilteringSet))
+      return nullptr;
+    return gdef_accel.get_mark_set_bits (match_props >> 16);
+  }
+
   bool match_properties_mark (hb_codepoint_t  glyph,
 			      unsigned int    glyph_props,
-			      unsigned int    match_props) const
+			      unsigned int    match_props,
+			      const uint64_t *mark_set_bits) const
   {
     /* If using mark filtering sets, the high short of
      * match_props has the set index.
      */
     if (match_props & LookupFlag::UseMarkFilteringSet)
-      return gdef.mark_set_covers (match_props >> 16, glyph);
+      return mark_set_bits
+	   ? gdef_accel.mark_set_bits_cover (mark_set_bits, glyph)
+	   : gdef_accel.mark_set_covers (match_props >> 16, glyph);
 
     /* The second byte of match_props has the meaning
      * "ignore marks of attachment type different than
@@ -714,7 +943,8 @@ struct hb_ot_apply_context_t :
   }
 
   bool check_glyph_property (const hb_glyph_info_t *info,
-			     unsigned int  match_props) const
+			     unsigned int  match_props,
+			     const uint64_t *mark_set_bits = nullptr) const
   {
     hb_codepoint_t glyph = info->codepoint;
     unsigned int glyph_props = _hb_glyph_info_get_glyph_props (info);
@@ -726,7 +956,7 @@ struct hb_ot_apply_context_t :
       return false;
 
     if (unlikely (glyph_props & HB_OT_LAYOUT_GLYPH_PROPS_MARK))
-      return match_properties_mark (glyph, glyph_props, match_props);
+      return match_properties_mark (glyph, glyph_props, match_props, mark_set_bits);
 
     return true;
   }
@@ -754,7 +984,7 @@ struct hb_ot_apply_context_t :
     if (likely (has_glyph_classes))
     {
       props &= HB_OT_LAYOUT_GLYPH_PROPS_PRESERVE;
-      _hb_glyph_info_set_glyph_props (&buffer->cur(), props | gdef.get_glyph_props (glyph_index));
+      _hb_glyph_info_set_glyph_props (&buffer->cur(), props | gdef_accel.get_glyph_props (glyph_index));
     }
     else if (class_guess)
     {
@@ -768,7 +998,14 @@ struct hb_ot_apply_context_t :
   void replace_glyph (hb_codepoint_t glyph_index) const
   {
     _set_glyph_class (glyph_index);
-    (void) buffer->replace_glyph (glyph_index);
+    if (likely (buffer->have_output))
+      (void) buffer->replace_glyph (glyph_index);
+    else
+    {
+      /* In-place lookup; see hb_ot_layout_lookup_accelerator_t::is_inplace(). */
+      buffer->cur().codepoint = glyph_index;
+      buffer->idx++;
+    }
   }
   void replace_glyph_inplace (hb_codepoint_t glyph_index) const
   {
@@ -790,6 +1027,237 @@ struct hb_ot_apply_context_t :
 };
 
 
+#ifndef HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES
+#define HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES	256
+#endif
+/* Percentage of glyphs not covered by a lookup or subtable that its digest
+ * must let through before it is replaced by an exact bitmap. */
+#ifndef HB_OT_LAYOUT_COVERAGE_BITMAP_THRESHOLD
+#define HB_OT_LAYOUT_COVERAGE_BITMAP_THRESHOLD	25
+#endif
+
+/* Quick rejection of glyphs a lookup or subtable does not cover.  Uses a
+ * set digest, unless that lets through too many glyphs, in which case an
+ * exact bitmap of the covered glyph range is used instead. */
+struct hb_coverage_filter_t
+{
+  template <typename T>
+  void init (const T &coverage, unsigned num_glyphs)
+  {
+    digest.init ();
+    coverage.collect_coverage (&digest);
+
+    bitmap_start = 0;
+    bitmap = hb_array_t<const uint64_t> ();
+    storage.init ();
+    if (num_glyphs >= HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES &&
+	digest_saturated (num_glyphs))
+      init_bitmap (coverage, num_glyphs);
+  }
+  /* Adopts a filter saved in snapshot, whose bitmap is used in place.
+   * Returns false, leaving the filter empty, if the bitmap reaches past
+   * the glyphs of the face. */
+  bool init (const hb_ot_layout_snapshot_t &snapshot,
+	     const hb_ot_layout_snapshot_t::filter_t &filter,
+	     unsigned num_glyphs)
+  {
+    digest.init ();
+    bitmap_start = 0;
+    bitmap = hb_array_t<const uint64_t> ();
+    storage.init ();
+    if (filter.bitmap_length &&
+	(filter.bitmap_start >= num_glyphs ||
+	 filter.bitmap_length > (num_glyphs - filter.bitmap_start + 63) / 64))
+      return false;
+
+    digest = filter.digest;
+    bitmap_start = filter.bitmap_start;
+    bitmap = hb_array (snapshot.get_bitmap (&filter), filter.bitmap_length);
+    return true;
+  }
+  void fini () { storage.fini (); bitmap = hb_array_t<const uint64_t> (); }
+
+  /* Saves the filter into filter, but for the bitmap, which is returned
+   * for the caller to store and fill in the offset of. */
+  hb_array_t<const uint64_t> save (hb_ot_layout_snapshot_t::filter_t *filter) const
+  {
+    filter->digest = digest;
+    filter->bitmap_start = bitmap_start;
+    filter->bitmap_length = bitmap.length;
+    filter->bitmap = 0;
+    filter->reserved = 0;
+    return bitmap;
+  }
+
+  /* Whether the filter lets the first glyph of coverage through, as one
+   * built from coverage does. */
+  bool may_have_first (const Coverage &coverage) const
+  {
+    auto it = coverage.iter ();
+    return !it || may_have (*it);
+  }
+
+  bool may_have (hb_codepoint_t g) const
+  {
+    if (bitmap.length)
+    {
+      unsigned i = g - bitmap_start;
+      return i < bitmap.length * 64 && (bitmap.arrayZ[i / 64] >> (i % 64)) & 1;
+    }
+    return digest.may_have (g);
+  }
+
+  private:
+  /* Whether the digest lets through too many glyphs to be useful.  Only
+   * then is it worth collecting the exact coverage. */
+  bool digest_saturated (unsigned num_glyphs) const
+  {
+    unsigned step = num_glyphs / HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES;
+    unsigned hits = 0;
+    for (unsigned i = 0; i < HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES; i++)
+      hits += digest.may_have (i * step);
+    return hits * 100 >= HB_OT_LAYOUT_COVERAGE_BITMAP_THRESHOLD * HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES;
+  }
+
+  /* Replaces the digest with an exact bitmap of the covered glyphs, if
+   * the digest turns out to let through many glyphs that are not. */
+  template <typename T>
+  void init_bitmap (const T &coverage, unsigned num_glyphs)
+  {
+    hb_set_t glyphs;
+    coverage.collect_coverage (&glyphs);
+    if (unlikely (glyphs.in_error () || glyphs.is_empty ()))
+      return;
+
+    unsigned step = num_glyphs / HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES;
+    unsigned uncovered = 0, false_positives = 0;
+    for (unsigned i = 0; i < HB_OT_LAYOUT_COVERAGE_BITMAP_SAMPLES; i++)
+    {
+      hb_codepoint_t g = i * step;
+      if (glyphs.has (g))
+	continue;
+      uncovered++;
+      false_positives += digest.may_have (g);
+    }
+    if (false_positives * 100 < HB_OT_LAYOUT_COVERAGE_BITMAP_THRESHOLD * uncovered)
+      return;
+
+    hb_codepoint_t first = glyphs.get_min ();
+    hb_codepoint_t last = glyphs.get_max ();
+    if (unlikely (!storage.resize ((last - first) / 64 + 1)))
+    {
+      storage.fini ();
+      return;
+    }
+    bitmap_start = first;
+    for (hb_codepoint_t g : glyphs)
+    {
+      unsigned i = g - first;
+      storage.arrayZ[i / 64] |= 1ULL << (i % 64);
+    }
+    bitmap = storage.as_array ();
+  }
+
+  hb_set_digest_t digest;
+  /* Exact coverage, starting at glyph bitmap_start; empty unless the
+   * digest is too coarse.  Points into storage, or a snapshot. */
+  hb_codepoint_t bitmap_start;
+  hb_array_t<const uint64_t> bitmap;
+  hb_vector_t<uint64_t> storage;
+};
+
+/* Flattened Coverage and ClassDef tables of a GSUB/GPOS table, shared by
+ * the subtables referencing them, and decoded PairPos values, limited to
+ * a total size in bytes. */
+struct hb_flat_tables_t
+{
+  void init (unsigned budget_)
+  {
+    budget = budget_;
+    coverages.init ();
+    class_defs.init ();
+    pairs.init ();
+  }
+  void fini ()
+  {
+    _fini (coverages);
+    _fini (class_defs);
+    for (hb_flat_pairs_t *flat : pairs.values ())
+    {
+      flat->fini ();
+      hb_free (flat);
+    }
+    pairs.fini ();
+  }
+
+  bool enabled () const { return budget; }
+
+  template <typename Table>
+  const hb_flat_table_t<Table> *get (const Table &table)
+  {
+    auto &map = get_map (table);
+    hb_flat_table_t<Table> *flat = map.get ((uintptr_t) &table);
+    if (flat)
+      return flat;
+
+    flat = (hb_flat_table_t<Table> *) hb_calloc (1, sizeof (hb_flat_table_t<Table>));
+    if (unlikely (!flat))
+      return nullptr;
+    flat->init (table);
+    flat->flatten (&budget);
+    if (unlikely (!map.set ((uintptr_t) &table, flat)))
+    {
+      flat->fini ();
+      hb_free (flat);
+      return nullptr;
+    }
+    return flat;
+  }
+
+  /* Returns the decoded values of a PairPos subtable, or nullptr if they
+   * do not fit in the budget. */
+  template <typename T>
+  const hb_flat_pairs_t *get_pairs (const T &subtable)
+  {
+    hb_flat_pairs_t *flat = pairs.get ((uintptr_t) &subtable);
+    if (flat)
+      return flat;
+
+    flat = (hb_flat_pairs_t *) hb_calloc (1, sizeof (hb_flat_pairs_t));
+    if (unlikely (!flat))
+      return nullptr;
+    flat->init ();
+    if (!subtable.compile_pairs (flat, &budget) ||
+	unlikely (!pairs.set ((uintptr_t) &subtable, flat)))
+    {
+      flat->fini ();
+      hb_free (flat);
+      return nullptr;
+    }
+    return flat;
+  }
+
+  private:
+  hb_hashmap_t<uintptr_t, hb_flat_table_t<Coverage> *> &get_map (const Coverage &) { return coverages; }
+  hb_hashmap_t<uintptr_t, hb_flat_table_t<ClassDef> *> &get_map (const ClassDef &) { return class_defs; }
+
+  template <typename Table>
+  static void _fini (hb_hashmap_t<uintptr_t, hb_flat_table_t<Table> *> &map)
+  {
+    for (hb_flat_table_t<Table> *flat : map.values ())
+    {
+      flat->fini ();
+      hb_free (flat);
+    }
+    map.fini ();
+  }
+
+  unsigned budget;
+  hb_hashmap_t<uintptr_t, hb_flat_table_t<Coverage> *> coverages;
+  hb_hashmap_t<uintptr_t, hb_flat_table_t<ClassDef> *> class_defs;
+  hb_hashmap_t<uintptr_t, hb_flat_pairs_t *> pairs;
+};
+
 struct hb_accelerate_subtables_context_t :
        hb_dispatch_context_t<hb_accelerate_subtables_context_t>
 {
@@ -802,26 +1270,154 @@ struct hb_accelerate_subtables_context_t :
 
   typedef bool (*hb_apply_func_t) (const void *obj, OT::hb_ot_apply_context_t *c);
 
+  template <typename Type>
+  static inline void build_trie_to (const void *obj, const hb_flat_subtable_t *flat)
+  {
+    const Type *typed_obj = (const Type *) obj;
+    typed_obj->get_trie (flat);
+  }
+
+  typedef void (*hb_build_trie_func_t) (const void *obj, const hb_flat_subtable_t *flat);
+
   struct hb_applicable_t
   {
+    /* Returns false if snapshot_filter is given but does not fit the
+     * subtable, whose filter is then built from its coverage. */
     template <typename T>
-    void init (const T &obj_, hb_apply_func_t apply_func_)
+    bool init (const T &obj_, hb_apply_func_t apply_func_, unsigned num_glyphs,
+	       hb_flat_tables_t *flat_tables,
+	       const hb_ot_layout_snapshot_t *snapshot,
+	       const hb_ot_layout_snapshot_t::filter_t *snapshot_filter)
     {
       obj = &obj_;
       apply_func = apply_func_;
-      digest.init ();
-      obj_.get_coverage ().collect_coverage (&digest);
+      coverage = &obj_.get_coverage ();
+      bool adopted = snapshot_filter &&
+		     filter.init (*snapshot, *snapshot_filter, num_glyphs) &&
+		     filter.may_have_first (*coverage);
+      if (!adopted)
+      {
+	filter.fini ();
+	filter.init (*coverage, num_glyphs);
+      }
+
+      hb_memset (&flat, 0, sizeof (flat));
+      build_trie_func = _get_build_trie_func (obj_, hb_prioritize);
+      if (build_trie_func)
+	flat.subtable = obj;
+      if (flat_tables && flat_tables->enabled ())
+	init_flat (obj_, flat_tables);
+
+      return adopted || !snapshot_filter;
+    }
+    void fini ()
+    {
+      hb_ligature_trie_t *trie = flat.ligature_trie.get_relaxed ();
+      if (trie)
+      {
+	trie->fini ();
+	hb_free (trie);
+      }
     }
 
+    /* Builds the filter from the coverage, instead of a snapshot. */
+    void reinit_filter (unsigned num_glyphs)
+    {
+      filter.fini ();
+      filter.init (*coverage, num_glyphs);
+    }
+    const hb_coverage_filter_t &get_filter () const { return filter; }
+    const Coverage &get_coverage () const { return *coverage; }
+
+    bool may_have (hb_codepoint_t g) const
+    { return filter.may_have (g); }
+    bool covers (hb_codepoint_t g) const
+    { return filter.may_have (g) && coverage->get_coverage (g) != NOT_COVERED; }
+
     bool apply (OT::hb_ot_apply_context_t *c) const
     {
-      return digest.may_have (c->buffer->cur().codepoint) && apply_func (obj, c);
+      if (!may_have (c->buffer->cur().codepoint))
+	return false;
+      c->flat_subtable = &flat;
+      return apply_func (obj, c);
+    }
+
+    /* Builds the ligature trie of the subtable now, if it has one,
+     * instead of on first use. */
+    void build_trie () const
+    {
+      if (build_trie_func)
+	build_trie_func (obj, &flat);
     }
 
     private:
+    /* Only subtables matching by class, which provide get_class_defs(),
+     * get their tables flattened. */
+    template <typename T>
+    static auto _get_class_defs (const T &obj_, const ClassDef **class_defs, hb_priority<1>) HB_AUTO_RETURN
+    ( obj_.get_class_defs (class_defs) )
+    template <typename T>
+    static bool _get_class_defs (const T &obj_, const ClassDef **class_defs, hb_priority<0>)
+    { return false; }
+
+    /* Pair positioning subtables, which provide compile_pairs(), get
+     * their values decoded. */
+    template <typename T>
+    static auto _get_pairs (const T &obj_, hb_flat_tables_t *flat_tables, hb_priority<1>)
+    -> hb_head_t<const hb_flat_pairs_t *, decltype (&T::compile_pairs)>
+    { return flat_tables->get_pairs (obj_); }
+    template <typename T>
+    static const hb_flat_pairs_t *_get_pairs (const T &obj_, hb_flat_tables_t *flat_tables, hb_priority<0>)
+    { return nullptr; }
+
+    /* Ligature subtables, which provide compile_trie(), build their trie
+     * on first use, regardless of the flattening budget. */
+    template <typename T>
+    static auto _get_build_trie_func (const T &obj_, hb_priority<1>)
+    -> hb_head_t<hb_build_trie_func_t, decltype (&T::compile_trie)>
+    { return build_trie_to<T>; }
+    template <typename T>
+    static hb_build_trie_func_t _get_build_trie_func (const T &obj_, hb_priority<0>)
+    { return nullptr; }
+
+    template <typename T>
+    void init_flat (const T &obj_,
+		    hb_flat_tables_t *flat_tables)
+    {
+      const ClassDef *class_defs[ARRAY_LENGTH_CONST (flat.class_defs)] = {};
+      bool has_class_defs = _get_class_defs (obj_, class_defs, hb_prioritize);
+      if (has_class_defs)
+      {
+	flat.coverage = flat_tables->get (obj_.get_coverage ());
+	if (unlikely (!flat.coverage))
+	  return;
+	for (unsigned i = 0; i < ARRAY_LENGTH (flat.class_defs); i++)
+	{
+	  flat.class_defs[i] = flat_tables->get (class_defs[i] ? *class_defs[i] : Null (ClassDef));
+	  if (unlikely (!flat.class_defs[i]))
+	    return;
+	}
+      }
+
+      flat.pairs = _get_pairs (obj_, flat_tables, hb_prioritize);
+      if (!has_class_defs)
+      {
+	if (!flat.pairs)
+	  return;
+	flat.coverage = flat_tables->get (obj_.get_coverage ());
+	if (unlikely (!flat.coverage))
+	  return;
+      }
+
+      flat.subtable = obj;
+    }
+
     const void *obj;
     hb_apply_func_t apply_func;
-    hb_set_digest_t digest;
+    hb_build_trie_func_t build_trie_func;
+    const Coverage *coverage;
+    hb_coverage_filter_t filter;
+    hb_flat_subtable_t flat;
   };
 
   typedef hb_vector_t<hb_applicable_t> array_t;
@@ -830,16 +1426,32 @@ struct hb_accelerate_subtables_context_t :
   template <typename T>
   return_t dispatch (const T &obj)
   {
+    const hb_ot_layout_snapshot_t::filter_t *snapshot_filter = nullptr;
+    if (snapshot_lookup && array.length < snapshot_lookup->subtable_count)
+      snapshot_filter = &snapshot->get_subtables (snapshot_lookup)[array.length];
     hb_applicable_t *entry = array.push();
-    entry->init (obj, apply_to<T>);
+    if (!entry->init (obj, apply_to<T>, num_glyphs, flat_tables, snapshot, snapshot_filter))
+      snapshot_lookup = nullptr;
     return hb_empty_t ();
   }
   static return_t default_return_value () { return hb_empty_t (); }
 
-  hb_accelerate_subtables_context_t (array_t &array_) :
-				     array (array_) {}
+  hb_accelerate_subtables_context_t (array_t &array_,
+				     unsigned num_glyphs_ = 0,
+				     hb_flat_tables_t *flat_tables_ = nullptr,
+				     const hb_ot_layout_snapshot_t *snapshot_ = nullptr,
+				     const hb_ot_layout_snapshot_t::lookup_t *snapshot_lookup_ = nullptr) :
+				     array (array_),
+				     num_glyphs (num_glyphs_),
+				     flat_tables (flat_tables_),
+				     snapshot (snapshot_),
+				     snapshot_lookup (snapshot_lookup_) {}
 
   array_t &array;
+  unsigned num_glyphs;
+  hb_flat_tables_t *flat_tables;
+  const hb_ot_layout_snapshot_t *snapshot;
+  const hb_ot_layout_snapshot_t::lookup_t *snapshot_lookup;
 };
 
 
@@ -948,6 +1560,11 @@ static inline bool match_class (hb_codepoint_t glyph_id, const HBUINT16 &value,
   const ClassDef &class_def = *reinterpret_cast<const ClassDef *>(data);
   return class_def.get_class (glyph_id) == value;
 }
+static inline bool match_flat_class (hb_codepoint_t glyph_id, const HBUINT16 &value, const void *data)
+{
+  const hb_flat_table_t<ClassDef> &class_def = *reinterpret_cast<const hb_flat_table_t<ClassDef> *>(data);
+  return class_def.get (glyph_id) == value;
+}
 static inline bool match_coverage (hb_codepoint_t glyph_id, const HBUINT16 &value, const void *data)
 {
   const Offset16To<Coverage> &coverage = (const Offset16To<Coverage>&)value;
@@ -2124,10 +2741,29 @@ struct ContextFormat2
   }
 
   const Coverage &get_coverage () const { return this+coverage; }
+  bool get_class_defs (const ClassDef **class_defs) const
+  {
+    class_defs[0] = &(this+classDef);
+    return true;
+  }
 
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
+    const hb_flat_subtable_t *flat = c->get_flat_tables (this);
+    if (flat)
+    {
+      hb_codepoint_t glyph = c->buffer->cur().codepoint;
+      if (likely (flat->coverage->get (glyph) == NOT_COVERED)) return_trace (false);
+
+      const RuleSet &rule_set = this+ruleSet[flat->class_defs[0]->get (glyph)];
+      struct ContextApplyLookupContext lookup_context = {
+	{match_flat_class},
+	flat->class_defs[0]
+      };
+      return_trace (rule_set.apply (c, lookup_context));
+    }
+
     unsigned int index = (this+coverage).get_coverage (c->buffer->cur().codepoint);
     if (likely (index == NOT_COVERED)) return_trace (false);
 
@@ -3143,10 +3779,33 @@ struct ChainContextFormat2
   }
 
   const Coverage &get_coverage () const { return this+coverage; }
+  bool get_class_defs (const ClassDef **class_defs) const
+  {
+    class_defs[0] = &(this+backtrackClassDef);
+    class_defs[1] = &(this+inputClassDef);
+    class_defs[2] = &(this+lookaheadClassDef);
+    return true;
+  }
 
   bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
+    const hb_flat_subtable_t *flat = c->get_flat_tables (this);
+    if (flat)
+    {
+      hb_codepoint_t glyph = c->buffer->cur().codepoint;
+      if (likely (flat->coverage->get (glyph) == NOT_COVERED)) return_trace (false);
+
+      const ChainRuleSet &rule_set = this+ruleSet[flat->class_defs[1]->get (glyph)];
+      struct ChainContextApplyLookupContext lookup_context = {
+	{match_flat_class},
+	{flat->class_defs[0],
+	 flat->class_defs[1],
+	 flat->class_defs[2]}
+      };
+      return_trace (rule_set.apply (c, lookup_context));
+    }
+
     unsigned int index = (this+coverage).get_coverage (c->buffer->cur().codepoint);
     if (likely (index == NOT_COVERED)) return_trace (false);
 
@@ -3616,20 +4275,61 @@ struct Extension
 
 struct hb_ot_layout_lookup_accelerator_t
 {
+  /* The filters are taken from snapshot_lookup if given, unless any of
+   * them turns out not to fit the subtables of this lookup. */
   template <typename TLookup>
-  void init (const TLookup &lookup)
+  void init (const TLookup &lookup,
+	     unsigned num_glyphs = 0,
+	     hb_flat_tables_t *flat_tables = nullptr,
+	     const hb_ot_layout_snapshot_t *snapshot = nullptr,
+	     const hb_ot_layout_snapshot_t::lookup_t *snapshot_lookup = nullptr)
   {
-    digest.init ();
-    lookup.collect_coverage (&digest);
+    inplace = lookup.is_inplace ();
 
     subtables.init ();
-    OT::hb_accelerate_subtables_context_t c_accelerate_subtables (subtables);
+    OT::hb_accelerate_subtables_context_t c_accelerate_subtables (subtables, num_glyphs, flat_tables,
+								  snapshot, snapshot_lookup);
     lookup.dispatch (&c_accelerate_subtables);
+
+    bool adopted = snapshot_lookup &&
+		   c_accelerate_subtables.snapshot_lookup &&
+		   snapshot_lookup->subtable_count == subtables.length &&
+		   filter.init (*snapshot, snapshot_lookup->filter, num_glyphs);
+    for (unsigned int i = 0; adopted && i < subtables.length; i++)
+      adopted = filter.may_have_first (subtables[i].get_coverage ());
+    if (snapshot_lookup && !adopted)
+      for (unsigned int i = 0; i < subtables.length; i++)
+	subtables[i].reinit_filter (num_glyphs);
+    if (!adopted)
+    {
+      filter.fini ();
+      filter.init (lookup, num_glyphs);
+    }
+  }
+  void fini ()
+  {
+    for (unsigned int i = 0; i < subtables.length; i++)
+      subtables[i].fini ();
+    subtables.fini ();
+    filter.fini ();
   }
-  void fini () { subtables.fini (); }
 
   bool may_have (hb_codepoint_t g) const
-  { return digest.may_have (g); }
+  { return filter.may_have (g); }
+
+  bool is_inplace () const
+  { return inplace; }
+
+  /* Exact version of may_have(): whether any subtable covers g. */
+  bool covers (hb_codepoint_t g) const
+  {
+    if (!may_have (g))
+      return false;
+    for (unsigned int i = 0; i < subtables.length; i++)
+      if (subtables[i].covers (g))
+	return true;
+    return false;
+  }
 
   bool apply (hb_ot_apply_context_t *c) const
   {
@@ -3639,9 +4339,21 @@ struct hb_ot_layout_lookup_accelerator_t
     return false;
   }
 
+  /* Builds the ligature tries of the subtables that have one. */
+  void build_tries () const
+  {
+    for (unsigned int i = 0; i < subtables.length; i++)
+      subtables[i].build_trie ();
+  }
+
+  const hb_coverage_filter_t &get_filter () const { return filter; }
+  hb_array_t<const hb_accelerate_subtables_context_t::hb_applicable_t> get_subtables () const
+  { return subtables.as_array (); }
+
   private:
-  hb_set_digest_t digest;
+  hb_coverage_filter_t filter;
   hb_accelerate_subtables_context_t::array_t subtables;
+  bool inplace;
 };
 
 struct GSUBGPOS
@@ -3685,9 +4397,10 @@ struct GSUBGPOS
     *index = FeatureVariations::NOT_FOUND_INDEX;
     return false;
 #endif
-    return (version.to_int () >= 0x00010001u ? this+featureVars : Null (FeatureVariations))
-	    .find_index (coords, num_coords, index);
+    return get_feature_variations ().find_index (coords, num_coords, index);
   }
+  const FeatureVariations &get_feature_variations () const
+  { return version.to_int () >= 0x00010001u ? this+featureVars : Null (FeatureVariations); }
   const Feature& get_feature_variation (unsigned int feature_index,
 					unsigned int variations_index) const
   {
@@ -3934,20 +4647,63 @@ struct GSUBGPOS
 	this->table = hb_blob_get_empty ();
       }
 
+      this->flat_tables.init (face->flat_layout_budget);
+
+      /* Filters are adopted from a snapshot of the same table, if any. */
+      const hb_ot_layout_snapshot_t *snapshot = hb_ot_layout_snapshot_t::get_for_face (face);
+      const hb_ot_layout_snapshot_t::table_t *snapshot_table = snapshot ? snapshot->get_table (T::tableTag == HB_OT_TAG_GPOS) : nullptr;
+      if (snapshot_table && snapshot_table->lookup_count != this->lookup_count)
+	snapshot_table = nullptr;
+
+      unsigned int num_glyphs = face->get_num_glyphs ();
       for (unsigned int i = 0; i < this->lookup_count; i++)
-	this->accels[i].init (table->get_lookup (i));
+	this->accels[i].init (table->get_lookup (i), num_glyphs, &this->flat_tables,
+			      snapshot,
+			      snapshot_table ? snapshot->get_lookup (snapshot_table, i) : nullptr);
+
+#ifndef HB_NO_VAR
+      this->variations_cache.init (table->get_feature_variations ());
+#endif
     }
     ~accelerator_t ()
     {
       for (unsigned int i = 0; i < this->lookup_count; i++)
 	this->accels[i].fini ();
       hb_free (this->accels);
+      this->flat_tables.fini ();
+#ifndef HB_NO_VAR
+      this->variations_cache.fini ();
+#endif
       this->table.destroy ();
     }
 
+    /* Builds, up front, the data the lookups would otherwise build on
+     * first use: the ligature tries. */
+    void build_tries () const
+    {
+      for (unsigned int i = 0; i < this->lookup_count; i++)
+	this->accels[i].build_tries ();
+    }
+
+    bool find_variations_index (const int *coords, unsigned int num_coords,
+				unsigned int *index) const
+    {
+#ifdef HB_NO_VAR
+      *index = FeatureVariations::NOT_FOUND_INDEX;
+      return false;
+#else
+      return variations_cache.find_index (table->get_feature_variations (),
+					  coords, num_coords, index);
+#endif
+    }
+
     hb_blob_ptr_t<T> table;
     unsigned int lookup_count;
     hb_ot_layout_lookup_accelerator_t *accels;
+    hb_flat_tables_t flat_tables;
+#ifndef HB_NO_VAR
+    FeatureVariations::index_cache_t variations_cache;
+#endif
   };
 
   protected:
@@ -0,0 +1,553 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+
+#include "hb.hh"
+
+#ifndef HB_NO_OT_LAYOUT
+
+#include "hb-ot-layout-snapshot.hh"
+#include "hb-ot-face.hh"
+#include "hb-ot-layout-gsub-table.hh"
+#include "hb-ot-layout-gpos-table.hh"
+#include "hb-shape-plan.hh"
+
+
+struct hb_ot_layout_snapshot_t::plan_t
+{
+  uint32_t direction;
+  uint32_t script;
+  uint32_t language; /* Offset to a nul-terminated string, or zero. */
+  uint32_t variations_index[2]; /* GSUB/GPOS */
+  uint32_t required_feature_index[2]; /* GSUB/GPOS */
+  uint32_t required_feature_stage[2]; /* GSUB/GPOS */
+  uint32_t reserved;
+  array_t features; /* Of hb_ot_map_t::feature_map_t. */
+  array_t missing_features; /* Of hb_tag_t. */
+  array_t lookups[2]; /* GSUB/GPOS; of hb_ot_map_t::lookup_map_t. */
+  array_t stages[2]; /* GSUB/GPOS; of uint32_t last lookups. */
+  array_t lookup_sources[2]; /* GSUB/GPOS; of hb_ot_map_t::lookup_source_t. */
+};
+
+
+/* Hash of the bytes of a table, telling whether a snapshot was saved
+ * from the same one.  After fasthash64. */
+static uint64_t
+_hb_ot_layout_snapshot_hash_table (hb_face_t *face, hb_tag_t tag, unsigned int *length)
+{
+  hb_blob_t *blob = hb_face_reference_table (face, tag);
+  const char *bytes = blob->data;
+  *length = blob->length;
+
+  auto mix = [] (uint64_t h) -> uint64_t
+  {
+    h ^= h >> 23;
+    h *= 0x2127599bf4325c37ULL;
+    h ^= h >> 47;
+    return h;
+  };
+  const uint64_t m = 0x880355f21e6d1965ULL;
+  uint64_t h = *length * m;
+  unsigned int i = 0;
+  for (; i + 8 <= *length; i += 8)
+  {
+    uint64_t v;
+    hb_memcpy (&v, bytes + i, 8);
+    h = (h ^ mix (v)) * m;
+  }
+  if (i < *length)
+  {
+    uint64_t v = 0;
+    hb_memcpy (&v, bytes + i, *length - i);
+    h = (h ^ mix (v)) * m;
+  }
+
+  hb_blob_destroy (blob);
+  return mix (h);
+}
+
+
+/*
+ * hb_ot_layout_snapshot_writer_t
+ *
+ * A snapshot being created.
+ */
+
+struct hb_ot_layout_snapshot_writer_t
+{
+  hb_vector_t<char> data;
+
+  /* Appends length zero bytes, and returns their offset. */
+  uint32_t alloc (unsigned int length)
+  {
+    unsigned int offset = data.length;
+    if (unlikely (length > (unsigned) INT_MAX - 7 - offset ||
+		  !data.resize (offset + ((length + 7) & ~7u))))
+      return 0;
+    return offset;
+  }
+
+  uint32_t push (const void *p, unsigned int length)
+  {
+    uint32_t offset = alloc (length);
+    if (likely (!data.in_error ()))
+      hb_memcpy (data.arrayZ + offset, p, length);
+    return offset;
+  }
+
+  template <typename Type>
+  uint32_t push_array (hb_array_t<const Type> array,
+		       hb_ot_layout_snapshot_t::array_t *out)
+  {
+    out->length = array.length;
+    out->offset = push (array.arrayZ, array.get_size ());
+    return out->offset;
+  }
+
+  template <typename Type>
+  Type *get (uint32_t offset)
+  {
+    if (unlikely (data.in_error ()))
+      return &Crap (Type);
+    return (Type *) (data.arrayZ + offset);
+  }
+
+  void save_filter (const OT::hb_coverage_filter_t &filter, uint32_t offset)
+  {
+    hb_ot_layout_snapshot_t::filter_t f;
+    hb_array_t<const uint64_t> bitmap = filter.save (&f);
+    if (bitmap.length)
+      f.bitmap = push (bitmap.arrayZ, bitmap.get_size ());
+    *get<hb_ot_layout_snapshot_t::filter_t> (offset) = f;
+  }
+
+  template <typename Accelerator>
+  uint32_t save_table (const Accelerator &accel)
+  {
+    typedef hb_ot_layout_snapshot_t::lookup_t lookup_t;
+    typedef hb_ot_layout_snapshot_t::filter_t filter_t;
+
+    uint32_t table = alloc (sizeof (hb_ot_layout_snapshot_t::table_t));
+    uint32_t lookups = alloc (accel.lookup_count * sizeof (lookup_t));
+    get<hb_ot_layout_snapshot_t::table_t> (table)->lookup_count = accel.lookup_count;
+    get<hb_ot_layout_snapshot_t::table_t> (table)->lookups = lookups;
+
+    for (unsigned int i = 0; i < accel.lookup_count; i++)
+    {
+      const OT::hb_ot_layout_lookup_accelerator_t &lookup = accel.accels[i];
+      auto subtables = lookup.get_subtables ();
+      uint32_t filters = alloc (subtables.length * sizeof (filter_t));
+      uint32_t offset = lookups + i * sizeof (lookup_t);
+      get<lookup_t> (offset)->subtable_count = subtables.length;
+      get<lookup_t> (offset)->subtables = filters;
+
+      save_filter (lookup.get_filter (), offset + offsetof (lookup_t, filter));
+      for (unsigned int j = 0; j < subtables.length; j++)
+	save_filter (subtables[j].get_filter (), filters + j * sizeof (filter_t));
+    }
+
+    return table;
+  }
+};
+
+
+/*
+ * hb_ot_layout_snapshot_t
+ */
+
+const hb_ot_layout_snapshot_t *
+hb_ot_layout_snapshot_t::get_for_face (const hb_face_t *face)
+{
+  hb_blob_t *blob = face->layout_snapshot.get ();
+  return blob ? (const hb_ot_layout_snapshot_t *) blob->data : nullptr;
+}
+
+hb_blob_t *
+hb_ot_layout_snapshot_t::create (hb_face_t        *face,
+				 hb_shape_plan_t **shape_plans,
+				 unsigned int      num_shape_plans)
+{
+  hb_ot_layout_snapshot_writer_t w;
+
+  uint32_t header = w.alloc (sizeof (hb_ot_layout_snapshot_t));
+  {
+    hb_ot_layout_snapshot_t *h = w.get<hb_ot_layout_snapshot_t> (header);
+    h->magic = HB_OT_LAYOUT_SNAPSHOT_MAGIC;
+    h->version = HB_OT_LAYOUT_SNAPSHOT_VERSION;
+    h->hb_version[0] = HB_VERSION_MAJOR;
+    h->hb_version[1] = HB_VERSION_MINOR;
+    h->hb_version[2] = HB_VERSION_MICRO;
+    h->digest_size = sizeof (hb_set_digest_t);
+    h->num_glyphs = face->get_num_glyphs ();
+    for (unsigned int table_index = 0; table_index < 2; table_index++)
+    {
+      unsigned int table_length;
+      h->table_hashes[table_index] = _hb_ot_layout_snapshot_hash_table (face, table_tags[table_index], &table_length);
+      h->table_lengths[table_index] = table_length;
+    }
+  }
+
+  uint32_t gsub = w.save_table (*face->table.GSUB);
+  uint32_t gpos = w.save_table (*face->table.GPOS);
+  w.get<hb_ot_layout_snapshot_t> (header)->tables[0] = gsub;
+  w.get<hb_ot_layout_snapshot_t> (header)->tables[1] = gpos;
+
+  unsigned int plan_count = 0;
+  for (unsigned int i = 0; i < num_shape_plans; i++)
+  {
+    const hb_shape_plan_t *shape_plan = shape_plans[i];
+    if (hb_object_is_valid (shape_plan) &&
+	shape_plan->face_unsafe == face &&
+	shape_plan->key.shaper_func == _hb_ot_shape)
+      plan_count++;
+  }
+  uint32_t plans = w.alloc (plan_count * sizeof (plan_t));
+  w.get<hb_ot_layout_snapshot_t> (header)->plan_count = plan_count;
+  w.get<hb_ot_layout_snapshot_t> (header)->plans = plans;
+
+  for (unsigned int i = 0, j = 0; i < num_shape_plans; i++)
+  {
+    const hb_shape_plan_t *shape_plan = shape_plans[i];
+    if (!(hb_object_is_valid (shape_plan) &&
+	  shape_plan->face_unsafe == face &&
+	  shape_plan->key.shaper_func == _hb_ot_shape))
+      continue;
+
+    const hb_shape_plan_key_t &key = shape_plan->key;
+    const hb_ot_map_t &map = shape_plan->ot.map;
+    plan_t plan;
+    hb_memset (&plan, 0, sizeof (plan));
+    plan.direction = key.props.direction;
+    plan.script = key.props.script;
+    if (key.props.language)
+    {
+      const char *language = hb_language_to_string (key.props.language);
+      plan.language = w.push (language, strlen (language) + 1);
+    }
+    w.push_array (map.features.as_array (), &plan.features);
+    w.push_array (map.missing_features.as_array (), &plan.missing_features);
+    for (unsigned int table_index = 0; table_index < 2; table_index++)
+    {
+      plan.variations_index[table_index] = key.ot.variations_index[table_index];
+      plan.required_feature_index[table_index] = map.required_feature_index[table_index];
+      plan.required_feature_stage[table_index] = map.required_feature_stage[table_index];
+      w.push_array (map.lookups[table_index].as_array (), &plan.lookups[table_index]);
+      w.push_array (map.lookup_sources[table_index].as_array (), &plan.lookup_sources[table_index]);
+
+      const hb_vector_t<hb_ot_map_t::stage_map_t> &stages = map.stages[table_index];
+      plan.stages[table_index].length = stages.length;
+      plan.stages[table_index].offset = w.alloc (stages.length * sizeof (uint32_t));
+      for (unsigned int k = 0; k < stages.length; k++)
+	w.get<uint32_t> (plan.stages[table_index].offset)[k] = stages.arrayZ[k].last_lookup;
+    }
+    /* Plans whose lookups were not all recorded cannot be derived from. */
+    if (map.lookup_sources[0].in_error () || map.lookup_sources[1].in_error ())
+      hb_memset (&plan, 0, sizeof (plan));
+
+    *w.get<plan_t> (plans + j++ * sizeof (plan_t)) = plan;
+  }
+
+  if (unlikely (w.data.in_error ()))
+    return hb_blob_get_empty ();
+  w.get<hb_ot_layout_snapshot_t> (header)->length = w.data.length;
+
+  hb_blob_t *blob = hb_blob_create_or_fail (w.data.arrayZ, w.data.length,
+					    HB_MEMORY_MODE_WRITABLE,
+					    w.data.arrayZ, hb_free);
+  w.data.init (); /* Owned by blob now. */
+  return blob ? blob : hb_blob_get_empty ();
+}
+
+bool
+hb_ot_layout_snapshot_t::check_range (uint32_t offset, uint32_t count, unsigned int size) const
+{
+  return offset % 8 == 0 &&
+	 offset <= length &&
+	 count <= (length - offset) / size;
+}
+
+bool
+hb_ot_layout_snapshot_t::check_filter (const filter_t &filter) const
+{
+  return !filter.bitmap_length ||
+	 check_range (filter.bitmap, filter.bitmap_length, sizeof (uint64_t));
+}
+
+bool
+hb_ot_layout_snapshot_t::check (hb_face_t *face, unsigned int blob_length) const
+{
+  if (magic != HB_OT_LAYOUT_SNAPSHOT_MAGIC ||
+      version != HB_OT_LAYOUT_SNAPSHOT_VERSION ||
+      hb_version[0] != HB_VERSION_MAJOR ||
+      hb_version[1] != HB_VERSION_MINOR ||
+      hb_version[2] != HB_VERSION_MICRO ||
+      digest_size != sizeof (hb_set_digest_t) ||
+      length != blob_length)
+    return false;
+
+  /* Whether it is a snapshot of face. */
+  if (num_glyphs != face->get_num_glyphs ())
+    return false;
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    unsigned int table_length;
+    if (table_hashes[table_index] != _hb_ot_layout_snapshot_hash_table (face, table_tags[table_index], &table_length) ||
+	table_lengths[table_index] != table_length)
+      return false;
+  }
+
+  /* Whether it is well-formed. */
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    if (!tables[table_index])
+      continue;
+    if (!check_range (tables[table_index], 1, sizeof (table_t)))
+      return false;
+    const table_t *table = get_table (table_index);
+    if (!check_range (table->lookups, table->lookup_count, sizeof (lookup_t)))
+      return false;
+    for (unsigned int i = 0; i < table->lookup_count; i++)
+    {
+      const lookup_t *lookup = get_lookup (table, i);
+      if (!check_filter (lookup->filter) ||
+	  !check_range (lookup->subtables, lookup->subtable_count, sizeof (filter_t)))
+	return false;
+      const filter_t *subtables = get_subtables (lookup);
+      for (unsigned int j = 0; j < lookup->subtable_count; j++)
+	if (!check_filter (subtables[j]))
+	  return false;
+    }
+  }
+
+  if (!check_range (plans, plan_count, sizeof (plan_t)))
+    return false;
+  for (unsigned int i = 0; i < plan_count; i++)
+  {
+    const plan_t &plan = get<plan_t> (plans)[i];
+    if (plan.language &&
+	(plan.language >= length ||
+	 !memchr (get<char> (plan.language), 0, length - plan.language)))
+      return false;
+    if (!check_range (plan.features.offset, plan.features.length, sizeof (hb_ot_map_t::feature_map_t)) ||
+	!check_range (plan.missing_features.offset, plan.missing_features.length, sizeof (hb_tag_t)))
+      return false;
+    for (unsigned int table_index = 0; table_index < 2; table_index++)
+      if (!check_range (plan.lookups[table_index].offset, plan.lookups[table_index].length, sizeof (hb_ot_map_t::lookup_map_t)) ||
+	  !check_range (plan.stages[table_index].offset, plan.stages[table_index].length, sizeof (uint32_t)) ||
+	  !check_range (plan.lookup_sources[table_index].offset, plan.lookup_sources[table_index].length, sizeof (hb_ot_map_t::lookup_source_t)))
+	return false;
+  }
+
+  return true;
+}
+
+template <typename Vector>
+static bool
+_hb_ot_layout_snapshot_load_array (const hb_ot_layout_snapshot_t       *snapshot,
+				   const hb_ot_layout_snapshot_t::array_t &array,
+				   Vector                              &vector)
+{
+  if (unlikely (!vector.resize (array.length)))
+    return false;
+  hb_memcpy (vector.arrayZ, snapshot->get<char> (array.offset), vector.get_size ());
+  return true;
+}
+
+bool
+hb_ot_layout_snapshot_t::get_map (hb_face_t                 *face,
+				  const hb_shape_plan_key_t *key,
+				  hb_ot_map_t               *map) const
+{
+  if (key->shaper_func != _hb_ot_shape)
+    return false;
+
+  const plan_t *plan = nullptr;
+  for (unsigned int i = 0; i < plan_count; i++)
+  {
+    const plan_t &p = get<plan_t> (plans)[i];
+    if (p.direction == (unsigned) key->props.direction &&
+	p.script == (unsigned) key->props.script &&
+	p.variations_index[0] == key->ot.variations_index[0] &&
+	p.variations_index[1] == key->ot.variations_index[1] &&
+	(p.language ? hb_language_from_string (get<char> (p.language), -1) : HB_LANGUAGE_INVALID) == key->props.language)
+    {
+      plan = &p;
+      break;
+    }
+  }
+  if (!plan)
+    return false;
+
+  if (unlikely (!_hb_ot_layout_snapshot_load_array (this, plan->features, map->features) ||
+		!_hb_ot_layout_snapshot_load_array (this, plan->missing_features, map->missing_features)))
+    return false;
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    if (unlikely (!_hb_ot_layout_snapshot_load_array (this, plan->lookups[table_index], map->lookups[table_index]) ||
+		  !_hb_ot_layout_snapshot_load_array (this, plan->lookup_sources[table_index], map->lookup_sources[table_index]) ||
+		  !map->stages[table_index].resize (plan->stages[table_index].length)))
+      return false;
+    const uint32_t *stages = get<uint32_t> (plan->stages[table_index].offset);
+    for (unsigned int i = 0; i < map->stages[table_index].length; i++)
+    {
+      map->stages[table_index].arrayZ[i].last_lookup = stages[i];
+      map->stages[table_index].arrayZ[i].pause_func = nullptr;
+    }
+    map->required_feature_index[table_index] = plan->required_feature_index[table_index];
+    map->required_feature_stage[table_index] = plan->required_feature_stage[table_index];
+  }
+
+  /* The map is checked against face, as plans derived from it are
+   * applied with its lookups. */
+  unsigned int feature_counts[2], lookup_counts[2];
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    feature_counts[table_index] = hb_ot_layout_table_get_feature_tags (face, table_tags[table_index], 0, nullptr, nullptr);
+    lookup_counts[table_index] = hb_ot_layout_table_get_lookup_count (face, table_tags[table_index]);
+  }
+  for (unsigned int i = 0; i < map->features.length; i++)
+  {
+    const hb_ot_map_t::feature_map_t &feature = map->features.arrayZ[i];
+    if (i && feature.tag <= map->features.arrayZ[i - 1].tag)
+      return false;
+    for (unsigned int table_index = 0; table_index < 2; table_index++)
+      if (feature.index[table_index] >= feature_counts[table_index] &&
+	  feature.index[table_index] != HB_OT_LAYOUT_NO_FEATURE_INDEX)
+	return false;
+  }
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    unsigned int lookup_count = map->lookups[table_index].length;
+    for (unsigned int i = 0; i < lookup_count; i++)
+    {
+      hb_ot_map_t::lookup_map_t &lookup = map->lookups[table_index].arrayZ[i];
+      if (lookup.index >= lookup_counts[table_index])
+	return false;
+      /* As hb_ot_map_builder_t::compile() does; the snapshot's bit is
+       * not trusted, as it picks how lookups are applied. */
+      lookup.single = table_index == 0 &&
+		      hb_ot_layout_lookup_is_single_substitution (face, lookup.index);
+    }
+    unsigned int last_lookup = 0;
+    for (const hb_ot_map_t::stage_map_t &stage : map->stages[table_index])
+    {
+      if (stage.last_lookup < last_lookup || stage.last_lookup > lookup_count)
+	return false;
+      last_lookup = stage.last_lookup;
+    }
+    for (const hb_ot_map_t::lookup_source_t &source : map->lookup_sources[table_index])
+      if (source.lookup >= lookup_count ||
+	  (source.feature >= map->features.length &&
+	   source.feature != hb_ot_map_t::lookup_source_t::REQUIRED))
+	return false;
+  }
+
+  return true;
+}
+
+
+/**
+ * hb_ot_layout_create_snapshot:
+ * @face: #hb_face_t to work upon
+ * @shape_plans: (array length=num_shape_plans) (nullable): Shape plans to include
+ * @num_shape_plans: The number of shape plans in @shape_plans
+ *
+ * Saves what is built when the GSUB and GPOS tables of @face are first
+ * used for shaping, and the compiled @shape_plans, into a snapshot.
+ * The snapshot can be adopted with hb_ot_layout_adopt_snapshot() by
+ * another face of the same font, typically in another process, instead
+ * of building the same again.
+ *
+ * Snapshots can only be adopted by the same version of HarfBuzz, built
+ * for the same platform.  The GSUB and GPOS tables of @face are loaded
+ * if they were not yet.  Shape plans not created for @face by the
+ * OpenType shaper are skipped.
+ *
+ * Return value: (transfer full): The snapshot, or the empty blob on
+ * failure.
+ *
+ * Since: REPLACEME
+ **/
+hb_blob_t *
+hb_ot_layout_create_snapshot (hb_face_t        *face,
+			      hb_shape_plan_t **shape_plans,
+			      unsigned int      num_shape_plans)
+{
+  if (unlikely (!hb_object_is_valid (face)))
+    return hb_blob_get_empty ();
+
+  return hb_ot_layout_snapshot_t::create (face, shape_plans, num_shape_plans);
+}
+
+/**
+ * hb_ot_layout_adopt_snapshot:
+ * @face: #hb_face_t to work upon
+ * @snapshot: A snapshot created with hb_ot_layout_create_snapshot()
+ *
+ * Adopts @snapshot for @face.  The coverage digests and bitmaps of the
+ * GSUB and GPOS lookups of @face are then taken from @snapshot instead
+ * of being built, and shape plans for the segment properties of the
+ * plans in @snapshot are derived from those.
+ *
+ * The data of @snapshot is used in place and must be 8-byte aligned, as
+ * it is when a snapshot file is mapped into memory with
+ * hb_blob_create_from_file().  @snapshot is made immutable.
+ *
+ * The snapshot is only adopted if it was created by the same version
+ * of HarfBuzz, from a face with the same number of glyphs and the same
+ * GSUB and GPOS tables, as told by hashes of their data.  Only
+ * one snapshot can be adopted per face.  Like with
+ * hb_face_set_flat_layout_budget(), the snapshot has to be adopted
+ * before @face is first used for shaping; this function can be called
+ * on an immutable face for that reason.
+ *
+ * Return value: %true if @snapshot was adopted, %false otherwise
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_ot_layout_adopt_snapshot (hb_face_t *face,
+			     hb_blob_t *snapshot)
+{
+  if (unlikely (!hb_object_is_valid (face) ||
+		snapshot->length < sizeof (hb_ot_layout_snapshot_t) ||
+		(uintptr_t) snapshot->data % 8))
+    return false;
+
+  const hb_ot_layout_snapshot_t *s = (const hb_ot_layout_snapshot_t *) snapshot->data;
+  if (!s->check (face, snapshot->length))
+    return false;
+
+  hb_blob_make_immutable (snapshot);
+  hb_blob_t *blob = hb_blob_reference (snapshot);
+  if (unlikely (!face->layout_snapshot.cmpexch (nullptr, blob)))
+  {
+    hb_blob_destroy (blob);
+    return false;
+  }
+  return true;
+}
+
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+
+#ifndef HB_OT_LAYOUT_SNAPSHOT_HH
+#define HB_OT_LAYOUT_SNAPSHOT_HH
+
+#include "hb.hh"
+#include "hb-set-digest.hh"
+
+
+/*
+ * hb_ot_layout_snapshot_t
+ *
+ * What is built when the layout tables of a face are first used, saved
+ * for adopting in another process.  See hb_ot_layout_create_snapshot().
+ *
+ * Snapshots are in native byte order and structure layout, and are only
+ * adopted by the same version of HarfBuzz.  All offsets are in bytes,
+ * from the start of the snapshot, and aligned to 8 bytes.
+ */
+
+struct hb_ot_map_t;
+struct hb_shape_plan_key_t;
+
+#define HB_OT_LAYOUT_SNAPSHOT_MAGIC	HB_TAG ('h','b','L','S')
+#define HB_OT_LAYOUT_SNAPSHOT_VERSION	1u
+
+struct hb_ot_layout_snapshot_t
+{
+  /* Coverage filter of a lookup or subtable. */
+  struct filter_t
+  {
+    hb_set_digest_t digest;
+    uint32_t bitmap_start;
+    uint32_t bitmap_length; /* In 64-bit words; zero for none. */
+    uint32_t bitmap; /* Offset. */
+    uint32_t reserved;
+  };
+
+  struct lookup_t
+  {
+    filter_t filter;
+    uint32_t subtable_count;
+    uint32_t subtables; /* Offset to subtable_count filters. */
+  };
+
+  /* GSUB or GPOS. */
+  struct table_t
+  {
+    uint32_t lookup_count;
+    uint32_t lookups; /* Offset to lookup_count lookups. */
+  };
+
+  struct array_t
+  {
+    uint32_t length;
+    uint32_t offset;
+  };
+
+  /* The map of a shape plan. */
+  struct plan_t;
+
+  template <typename Type>
+  const Type *get (uint32_t offset) const
+  { return (const Type *) ((const char *) this + offset); }
+
+  const table_t *get_table (unsigned int table_index) const
+  { return tables[table_index] ? get<table_t> (tables[table_index]) : nullptr; }
+  const lookup_t *get_lookup (const table_t *table, unsigned int lookup_index) const
+  { return &get<lookup_t> (table->lookups)[lookup_index]; }
+  const filter_t *get_subtables (const lookup_t *lookup) const
+  { return get<filter_t> (lookup->subtables); }
+  const uint64_t *get_bitmap (const filter_t *filter) const
+  { return get<uint64_t> (filter->bitmap); }
+
+  /* The snapshot adopted by face, if any.  Adopted snapshots have been
+   * checked to be well-formed. */
+  HB_INTERNAL static const hb_ot_layout_snapshot_t *get_for_face (const hb_face_t *face);
+
+  /* Saves the built layout tables of face and shape_plans. */
+  HB_INTERNAL static hb_blob_t *create (hb_face_t        *face,
+					hb_shape_plan_t **shape_plans,
+					unsigned int      num_shape_plans);
+
+  /* Whether the snapshot, of blob_length bytes, is well-formed and was
+   * saved from face. */
+  HB_INTERNAL bool check (hb_face_t *face, unsigned int blob_length) const;
+
+  /* Fills map with the map of a plan of the snapshot, if any, with the
+   * same properties and feature variations as key, for deriving a plan
+   * for key from. */
+  HB_INTERNAL bool get_map (hb_face_t                 *face,
+			    const hb_shape_plan_key_t *key,
+			    hb_ot_map_t               *map) const;
+
+  private:
+  HB_INTERNAL bool check_range (uint32_t offset, uint32_t count, unsigned int size) const;
+  HB_INTERNAL bool check_filter (const filter_t &filter) const;
+
+  public:
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t hb_version[3];
+  uint32_t digest_size;
+  uint32_t length;
+  uint32_t num_glyphs;
+  uint64_t table_hashes[2]; /* GSUB/GPOS; of the table bytes. */
+  uint32_t table_lengths[2]; /* GSUB/GPOS */
+  uint32_t tables[2]; /* GSUB/GPOS; offsets, or zero for none. */
+  uint32_t plan_count;
+  uint32_t plans; /* Offset to plan_count plans. */
+};
+
+
+#endif /* HB_OT_LAYOUT_SNAPSHOT_HH */
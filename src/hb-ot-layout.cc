@@ -254,7 +254,7 @@ _hb_ot_layout_set_glyph_props (hb_font_t *font,
 {
   _hb_buffer_assert_gsubgpos_vars (buffer);
 
-  const OT::GDEF &gdef = *font->face->table.GDEF->table;
+  const OT::GDEF::accelerator_t &gdef = *font->face->table.GDEF;
   unsigned int count = buffer->len;
   for (unsigned int i = 0; i < count; i++)
   {
@@ -1324,9 +1324,11 @@ hb_ot_layout_table_find_feature_variations (hb_face_t    *face,
 					    unsigned int  num_coords,
 					    unsigned int *variations_index /* out */)
 {
-  const OT::GSUBGPOS &g = get_gsubgpos_table (face, table_tag);
-
-  return g.find_variations_index (coords, num_coords, variations_index);
+  switch (table_tag) {
+    case HB_OT_TAG_GSUB: return face->table.GSUB->find_variations_index (coords, num_coords, variations_index);
+    case HB_OT_TAG_GPOS: return face->table.GPOS->find_variations_index (coords, num_coords, variations_index);
+    default:             return Null (OT::GSUBGPOS).find_variations_index (coords, num_coords, variations_index);
+  }
 }
 
 
@@ -1418,6 +1420,16 @@ hb_ot_layout_lookup_would_substitute (hb_face_t            *face,
 }
 
 
+/* Whether a GSUB lookup consists of single substitutions only; runs of
+ * these are applied in one pass.  See hb_ot_map_t::apply(). */
+bool
+hb_ot_layout_lookup_is_single_substitution (hb_face_t    *face,
+					    unsigned int  lookup_index)
+{
+  if (unlikely (lookup_index >= face->table.GSUB->lookup_count)) return false;
+  return face->table.GSUB->table->get_lookup (lookup_index).is_single ();
+}
+
 /**
  * hb_ot_layout_substitute_start:
  * @font: #hb_font_t to use
@@ -1834,7 +1846,7 @@ apply_forward (OT::hb_ot_apply_context_t *c,
     bool applied = false;
     if (accel.may_have (buffer->cur().codepoint) &&
 	(buffer->cur().mask & c->lookup_mask) &&
-	c->check_glyph_property (&buffer->cur(), c->lookup_props))
+	c->check_glyph_property (&buffer->cur(), c->lookup_props, c->lookup_mark_set_bits))
      {
        applied = accel.apply (c);
      }
@@ -1857,7 +1869,7 @@ apply_backward (OT::hb_ot_apply_context_t *c,
   {
     if (accel.may_have (buffer->cur().codepoint) &&
 	(buffer->cur().mask & c->lookup_mask) &&
-	c->check_glyph_property (&buffer->cur(), c->lookup_props))
+	c->check_glyph_property (&buffer->cur(), c->lookup_props, c->lookup_mark_set_bits))
      ret |= accel.apply (c);
 
     /* The reverse lookup doesn't "advance" cursor (for good reason). */
@@ -1883,14 +1895,16 @@ apply_string (OT::hb_ot_apply_context_t *c,
 
   if (likely (!lookup.is_reverse ()))
   {
-    /* in/out forward substitution/positioning */
-    if (!Proxy::inplace)
+    /* in/out forward substitution/positioning; lookups that only
+     * replace glyphs one for one run in-place. */
+    bool inplace = Proxy::inplace || accel.is_inplace ();
+    if (!inplace)
       buffer->clear_output ();
 
     buffer->idx = 0;
     apply_forward (c, accel);
 
-    if (!Proxy::inplace)
+    if (!inplace)
       buffer->sync ();
   }
   else
@@ -1902,6 +1916,67 @@ apply_string (OT::hb_ot_apply_context_t *c,
   }
 }
 
+#ifndef HB_OT_LAYOUT_MAX_SINGLE_RUN
+#define HB_OT_LAYOUT_MAX_SINGLE_RUN 32
+#endif
+
+/* Applies a run of single substitution lookups in one pass over the
+ * buffer.  Each glyph goes through all the lookups in order.  Since
+ * single substitutions look at no other glyph, this is the same as
+ * applying the lookups to the buffer one after the other. */
+template <typename Proxy>
+static inline void
+apply_single_run (OT::hb_ot_apply_context_t *c,
+		  const Proxy &proxy,
+		  hb_array_t<const hb_ot_map_t::lookup_map_t> lookups)
+{
+  hb_buffer_t *buffer = c->buffer;
+
+  struct
+  {
+    const OT::hb_ot_layout_lookup_accelerator_t *accel;
+    const uint64_t *mark_set_bits;
+    unsigned int index;
+    unsigned int props;
+    hb_mask_t mask;
+  } run[HB_OT_LAYOUT_MAX_SINGLE_RUN];
+  unsigned int count = hb_min (lookups.length, (unsigned) HB_OT_LAYOUT_MAX_SINGLE_RUN);
+  hb_mask_t run_mask = 0;
+  for (unsigned int j = 0; j < count; j++)
+  {
+    unsigned int index = lookups.arrayZ[j].index;
+    run[j].accel = &proxy.accels[index];
+    run[j].index = index;
+    run[j].props = proxy.table.get_lookup (index).get_props ();
+    run[j].mark_set_bits = c->get_mark_set_bits (run[j].props);
+    run[j].mask = lookups.arrayZ[j].mask;
+    run_mask |= run[j].mask;
+  }
+  if (unlikely (!buffer->len || !run_mask))
+    return;
+
+  assert (!buffer->have_output);
+  for (buffer->idx = 0; buffer->idx < buffer->len && buffer->successful; buffer->idx++)
+  {
+    hb_glyph_info_t &info = buffer->cur();
+    if (!(info.mask & run_mask))
+      continue;
+
+    for (unsigned int j = 0; j < count; j++)
+    {
+      if (run[j].accel->may_have (info.codepoint) &&
+	  (info.mask & run[j].mask) &&
+	  c->check_glyph_property (&info, run[j].props, run[j].mark_set_bits))
+      {
+	c->set_lookup_index (run[j].index);
+	/* Replacing the glyph in-place moves on to the next one; stay. */
+	if (run[j].accel->apply (c))
+	  buffer->idx--;
+      }
+    }
+  }
+}
+
 template <typename Proxy>
 inline void hb_ot_map_t::apply (const Proxy &proxy,
 				const hb_ot_shape_plan_t *plan,
@@ -1918,6 +1993,20 @@ inline void hb_ot_map_t::apply (const Proxy &proxy,
     const stage_map_t *stage = &stages[table_index][stage_index];
     for (; i < stage->last_lookup; i++)
     {
+      if (lookups[table_index][i].single && !buffer->messaging ())
+      {
+	unsigned int end = i + 1;
+	while (end < stage->last_lookup && end - i < HB_OT_LAYOUT_MAX_SINGLE_RUN &&
+	       lookups[table_index][end].single)
+	  end++;
+	if (end - i > 1)
+	{
+	  apply_single_run (&c, proxy, lookups[table_index].as_array ().sub_array (i, end - i));
+	  i = end - 1;
+	  continue;
+	}
+      }
+
       unsigned int lookup_index = lookups[table_index][i].index;
       if (!buffer->message (font, "start lookup %d", lookup_index)) continue;
       c.set_lookup_index (lookup_index);
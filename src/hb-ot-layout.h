@@ -487,6 +487,19 @@ hb_ot_layout_get_baseline_with_fallback (hb_font_t                   *font,
 					 hb_tag_t                     language_tag,
 					 hb_position_t               *coord        /* OUT */);
 
+/*
+ * Snapshots
+ */
+
+HB_EXTERN hb_blob_t *
+hb_ot_layout_create_snapshot (hb_face_t        *face,
+			      hb_shape_plan_t **shape_plans,
+			      unsigned int      num_shape_plans);
+
+HB_EXTERN hb_bool_t
+hb_ot_layout_adopt_snapshot (hb_face_t *face,
+			     hb_blob_t *snapshot);
+
 HB_END_DECLS
 
 #endif /* HB_OT_LAYOUT_H */
@@ -97,6 +97,10 @@ HB_MARK_AS_FLAG_T (hb_ot_layout_glyph_props_flags_t);
  */
 
 
+HB_INTERNAL bool
+hb_ot_layout_lookup_is_single_substitution (hb_face_t    *face,
+					    unsigned int  lookup_index);
+
 /* Should be called before all the substitute_lookup's are done. */
 HB_INTERNAL void
 hb_ot_layout_substitute_start (hb_font_t    *font,
@@ -163,9 +163,84 @@ void hb_ot_map_builder_t::add_pause (unsigned int table_index, hb_ot_map_t::paus
   current_stage[table_index]++;
 }
 
+static int
+_hb_ot_map_cmp_tag (const void *pa, const void *pb)
+{
+  hb_tag_t a = * (const hb_tag_t *) pa;
+  hb_tag_t b = * (const hb_tag_t *) pb;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+/* Copies the lookups of base, which has the same features, stages and
+ * lookups as m, only with different masks; and recomputes the masks from
+ * those of m's features.  Returns false if m differs otherwise.  The
+ * pause functions of the stages are the builder's, such that base can
+ * come from a snapshot. */
+bool
+hb_ot_map_builder_t::derive_lookups (hb_ot_map_t       &m,
+				     const hb_ot_map_t &base,
+				     hb_mask_t          global_bit_mask)
+{
+  if (m.features.length != base.features.length)
+    return false;
+  for (unsigned int i = 0; i < m.features.length; i++)
+  {
+    const hb_ot_map_t::feature_map_t &a = m.features.arrayZ[i];
+    const hb_ot_map_t::feature_map_t &b = base.features.arrayZ[i];
+    if (a.tag != b.tag ||
+	a.index[0] != b.index[0] || a.index[1] != b.index[1] ||
+	a.stage[0] != b.stage[0] || a.stage[1] != b.stage[1] ||
+	a.needs_fallback != b.needs_fallback ||
+	a.auto_zwnj != b.auto_zwnj || a.auto_zwj != b.auto_zwj ||
+	a.random != b.random || a.per_syllable != b.per_syllable)
+      return false;
+  }
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    if (m.required_feature_index[table_index] != base.required_feature_index[table_index] ||
+	m.required_feature_stage[table_index] != base.required_feature_stage[table_index] ||
+	stages[table_index].length != base.stages[table_index].length ||
+	base.lookup_sources[table_index].in_error ())
+      return false;
+  }
+
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    m.lookups[table_index] = base.lookups[table_index];
+    m.stages[table_index] = base.stages[table_index];
+    m.lookup_sources[table_index] = base.lookup_sources[table_index];
+    if (unlikely (m.lookups[table_index].in_error () ||
+		  m.stages[table_index].in_error () ||
+		  m.lookup_sources[table_index].in_error ()))
+    {
+      for (unsigned int i = 0; i <= table_index; i++)
+      {
+	m.lookups[i].resize (0);
+	m.stages[i].resize (0);
+	m.lookup_sources[i].resize (0);
+      }
+      return false;
+    }
+
+    for (unsigned int i = 0; i < stages[table_index].length; i++)
+      m.stages[table_index].arrayZ[i].pause_func = stages[table_index].arrayZ[i].pause_func;
+
+    hb_ot_map_t::lookup_map_t *lookups = m.lookups[table_index].arrayZ;
+    for (unsigned int i = 0; i < m.lookups[table_index].length; i++)
+      lookups[i].mask = 0;
+    for (const hb_ot_map_t::lookup_source_t &source : m.lookup_sources[table_index])
+      lookups[source.lookup].mask |= source.feature == hb_ot_map_t::lookup_source_t::REQUIRED ?
+				     global_bit_mask :
+				     m.features.arrayZ[source.feature].mask;
+  }
+
+  return true;
+}
+
 void
 hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
-			      const hb_ot_shape_plan_key_t &key)
+			      const hb_ot_shape_plan_key_t &key,
+			      const hb_ot_map_t            *base)
 {
   unsigned int global_bit_shift = 8 * sizeof (hb_mask_t) - 1;
   unsigned int global_bit_mask = 1u << global_bit_shift;
@@ -241,21 +316,44 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
       continue; /* Feature disabled, or not enough bits. */
 
 
-    bool found = false;
-    unsigned int feature_index[2];
     for (unsigned int table_index = 0; table_index < 2; table_index++)
-    {
       if (required_feature_tag[table_index] == info->tag)
 	required_feature_stage[table_index] = info->stage[table_index];
 
-      found |= (bool) hb_ot_layout_language_find_feature (face,
-							  table_tags[table_index],
-							  script_index[table_index],
-							  language_index[table_index],
-							  info->tag,
-							  &feature_index[table_index]);
+    bool found = false;
+    unsigned int feature_index[2];
+    /* Features of the same tag are searched for the same way in all plans
+     * of a face and properties; reuse what the base found. */
+    const hb_ot_map_t::feature_map_t *base_map = nullptr;
+    bool searched = false;
+    if (base)
+    {
+      base_map = base->features.bsearch (info->tag);
+      searched = base_map || hb_bsearch (info->tag,
+					 base->missing_features.arrayZ,
+					 base->missing_features.length,
+					 sizeof (hb_tag_t),
+					 _hb_ot_map_cmp_tag);
+    }
+    if (base_map)
+    {
+      for (unsigned int table_index = 0; table_index < 2; table_index++)
+      {
+	feature_index[table_index] = base_map->index[table_index];
+	found |= feature_index[table_index] != HB_OT_LAYOUT_NO_FEATURE_INDEX;
+      }
     }
-    if (!found && (info->flags & F_GLOBAL_SEARCH))
+    else if (searched)
+      feature_index[0] = feature_index[1] = HB_OT_LAYOUT_NO_FEATURE_INDEX;
+    else
+      for (unsigned int table_index = 0; table_index < 2; table_index++)
+	found |= (bool) hb_ot_layout_language_find_feature (face,
+							    table_tags[table_index],
+							    script_index[table_index],
+							    language_index[table_index],
+							    info->tag,
+							    &feature_index[table_index]);
+    if (!searched && !found && (info->flags & F_GLOBAL_SEARCH))
     {
       for (unsigned int table_index = 0; table_index < 2; table_index++)
       {
@@ -265,6 +363,8 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
 							 &feature_index[table_index]);
       }
     }
+    if (!found)
+      m.missing_features.push (info->tag);
     if (!found && !(info->flags & F_HAS_FALLBACK))
       continue;
 
@@ -299,6 +399,17 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
   add_gsub_pause (nullptr);
   add_gpos_pause (nullptr);
 
+  for (unsigned int table_index = 0; table_index < 2; table_index++)
+  {
+    m.required_feature_index[table_index] = required_feature_index[table_index];
+    m.required_feature_stage[table_index] = required_feature_stage[table_index];
+  }
+
+  /* Most plans differ from one with the same features only in masks. */
+  if (base && derive_lookups (m, *base, global_bit_mask))
+    return;
+
+  hb_vector_t<hb_pair_t<unsigned, unsigned>> sources; /* Lookup index, feature. */
   for (unsigned int table_index = 0; table_index < 2; table_index++)
   {
     /* Collect lookup indices for features */
@@ -307,15 +418,24 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
     unsigned int last_num_lookups = 0;
     for (unsigned stage = 0; stage < current_stage[table_index]; stage++)
     {
+      sources.resize (0);
       if (required_feature_index[table_index] != HB_OT_LAYOUT_NO_FEATURE_INDEX &&
 	  required_feature_stage[table_index] == stage)
+      {
+	unsigned int start = m.lookups[table_index].length;
 	add_lookups (m, table_index,
 		     required_feature_index[table_index],
 		     key.variations_index[table_index],
 		     global_bit_mask);
+	for (unsigned int j = start; j < m.lookups[table_index].length; j++)
+	  sources.push (hb_pair (m.lookups[table_index].arrayZ[j].index,
+				 (unsigned) hb_ot_map_t::lookup_source_t::REQUIRED));
+      }
 
       for (unsigned i = 0; i < m.features.length; i++)
 	if (m.features[i].stage[table_index] == stage)
+	{
+	  unsigned int start = m.lookups[table_index].length;
 	  add_lookups (m, table_index,
 		       m.features[i].index[table_index],
 		       key.variations_index[table_index],
@@ -324,6 +444,9 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
 		       m.features[i].auto_zwj,
 		       m.features[i].random,
 		       m.features[i].per_syllable);
+	  for (unsigned int j = start; j < m.lookups[table_index].length; j++)
+	    sources.push (hb_pair (m.lookups[table_index].arrayZ[j].index, i));
+	}
 
       /* Sort lookups and merge duplicates */
       if (last_num_lookups < m.lookups[table_index].length)
@@ -341,6 +464,26 @@ hb_ot_map_builder_t::compile (hb_ot_map_t                  &m,
 	    m.lookups[table_index][j].auto_zwj &= m.lookups[table_index][i].auto_zwj;
 	  }
 	m.lookups[table_index].shrink (j + 1);
+
+	for (unsigned int i = last_num_lookups; i < m.lookups[table_index].length; i++)
+	  m.lookups[table_index][i].single = table_index == 0 &&
+					     hb_ot_layout_lookup_is_single_substitution (face, m.lookups[table_index][i].index);
+
+	/* Find where each source's lookup ended up. */
+	hb_array_t<const hb_ot_map_t::lookup_map_t> stage_lookups = m.lookups[table_index].as_array ().sub_array (last_num_lookups);
+	for (const auto &source : sources)
+	{
+	  unsigned int lo = 0, hi = stage_lookups.length;
+	  while (hi - lo > 1)
+	  {
+	    unsigned int mid = (lo + hi) / 2;
+	    if (stage_lookups.arrayZ[mid].index <= source.first)
+	      lo = mid;
+	    else
+	      hi = mid;
+	  }
+	  m.lookup_sources[table_index].push (hb_ot_map_t::lookup_source_t {last_num_lookups + lo, source.second});
+	}
       }
 
       last_num_lookups = m.lookups[table_index].length;
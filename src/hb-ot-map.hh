@@ -42,6 +42,7 @@ static const hb_tag_t table_tags[2] = {HB_OT_TAG_GSUB, HB_OT_TAG_GPOS};
 struct hb_ot_map_t
 {
   friend struct hb_ot_map_builder_t;
+  friend struct hb_ot_layout_snapshot_t;
 
   public:
 
@@ -68,6 +69,7 @@ struct hb_ot_map_t
     unsigned short auto_zwj : 1;
     unsigned short random : 1;
     unsigned short per_syllable : 1;
+    unsigned short single : 1; /* Single substitution, fusable with its neighbors. */
     hb_mask_t mask;
 
     HB_INTERNAL static int cmp (const void *pa, const void *pb)
@@ -85,6 +87,16 @@ struct hb_ot_map_t
     pause_func_t pause_func;
   };
 
+  /* Records that a feature contributed its mask to a lookup, such that
+   * a map with the same features and lookups can be derived by just
+   * recomputing the masks. */
+  struct lookup_source_t {
+    enum { REQUIRED = (unsigned) -1 };
+
+    unsigned int lookup; /* Into lookups. */
+    unsigned int feature; /* Into features, or REQUIRED. */
+  };
+
   void init ()
   {
     memset (this, 0, sizeof (*this));
@@ -94,7 +106,9 @@ struct hb_ot_map_t
     {
       lookups[table_index].init ();
       stages[table_index].init ();
+      lookup_sources[table_index].init ();
     }
+    missing_features.init ();
   }
   void fini ()
   {
@@ -103,7 +117,9 @@ struct hb_ot_map_t
     {
       lookups[table_index].fini ();
       stages[table_index].fini ();
+      lookup_sources[table_index].fini ();
     }
+    missing_features.fini ();
   }
 
   hb_mask_t get_global_mask () const { return global_mask; }
@@ -154,6 +170,9 @@ struct hb_ot_map_t
     *lookup_count = end - start;
   }
 
+  hb_array_t<const lookup_map_t> get_lookups (unsigned int table_index) const
+  { return lookups[table_index].as_array (); }
+
   HB_INTERNAL void collect_lookups (unsigned int table_index, hb_set_t *lookups) const;
   template <typename Proxy>
   HB_INTERNAL void apply (const Proxy &proxy,
@@ -172,6 +191,10 @@ struct hb_ot_map_t
   hb_sorted_vector_t<feature_map_t> features;
   hb_vector_t<lookup_map_t> lookups[2]; /* GSUB/GPOS */
   hb_vector_t<stage_map_t> stages[2]; /* GSUB/GPOS */
+  hb_vector_t<lookup_source_t> lookup_sources[2]; /* GSUB/GPOS */
+  hb_vector_t<hb_tag_t> missing_features; /* Sorted; searched for, but not found. */
+  unsigned int required_feature_index[2];
+  unsigned int required_feature_stage[2];
 };
 
 enum hb_ot_map_feature_flags_t
@@ -228,11 +251,18 @@ struct hb_ot_map_builder_t
   void add_gpos_pause (hb_ot_map_t::pause_func_t pause_func)
   { add_pause (1, pause_func); }
 
+  /* If base is given, it must have been compiled for the same face,
+   * properties and key; its results are reused where they apply. */
   HB_INTERNAL void compile (hb_ot_map_t                  &m,
-			    const hb_ot_shape_plan_key_t &key);
+			    const hb_ot_shape_plan_key_t &key,
+			    const hb_ot_map_t            *base = nullptr);
 
   private:
 
+  HB_INTERNAL bool derive_lookups (hb_ot_map_t       &m,
+				   const hb_ot_map_t &base,
+				   hb_mask_t          global_bit_mask);
+
   HB_INTERNAL void add_lookups (hb_ot_map_t  &m,
 				unsigned int  table_index,
 				unsigned int  feature_index,
@@ -98,11 +98,12 @@ hb_ot_shape_planner_t::hb_ot_shape_planner_t (hb_face_t                     *fac
 
 void
 hb_ot_shape_planner_t::compile (hb_ot_shape_plan_t           &plan,
-				const hb_ot_shape_plan_key_t &key)
+				const hb_ot_shape_plan_key_t &key,
+				const hb_ot_map_t            *base_map)
 {
   plan.props = props;
   plan.shaper = shaper;
-  map.compile (plan.map, key);
+  map.compile (plan.map, key, base_map);
 #ifndef HB_NO_AAT_SHAPE
   if (apply_morx)
     aat_map.compile (plan.aat_map);
@@ -217,7 +218,8 @@ hb_ot_shape_planner_t::compile (hb_ot_shape_plan_t           &plan,
 
 bool
 hb_ot_shape_plan_t::init0 (hb_face_t                     *face,
-			   const hb_shape_plan_key_t     *key)
+			   const hb_shape_plan_key_t     *key,
+			   const hb_ot_map_t             *base_map)
 {
   map.init ();
 #ifndef HB_NO_AAT_SHAPE
@@ -231,7 +233,7 @@ hb_ot_shape_plan_t::init0 (hb_face_t                     *face,
 				key->user_features,
 				key->num_user_features);
 
-  planner.compile (*this, key->ot);
+  planner.compile (*this, key->ot, base_map);
 
   if (shaper->data_create)
   {
@@ -49,10 +49,15 @@ struct hb_ot_shape_plan_key_t
 						  &variations_index[table_index]);
   }
 
-  bool equal (const hb_ot_shape_plan_key_t *other)
+  bool equal (const hb_ot_shape_plan_key_t *other) const
   {
     return 0 == memcmp (this, other, sizeof (*this));
   }
+
+  uint32_t hash () const
+  {
+    return variations_index[0] * 31 + variations_index[1];
+  }
 };
 
 
@@ -134,8 +139,12 @@ struct hb_ot_shape_plan_t
     map.collect_lookups (table_index, lookups);
   }
 
+  /* If base_map is given, it must be the map of a plan of the same face,
+   * properties and key.ot; the new plan is derived from it where
+   * possible. */
   HB_INTERNAL bool init0 (hb_face_t                     *face,
-			  const hb_shape_plan_key_t     *key);
+			  const hb_shape_plan_key_t     *key,
+			  const hb_ot_map_t             *base_map = nullptr);
   HB_INTERNAL void fini ();
 
   HB_INTERNAL void substitute (hb_font_t *font, hb_buffer_t *buffer) const;
@@ -164,7 +173,8 @@ struct hb_ot_shape_planner_t
 				     const hb_segment_properties_t *props);
 
   HB_INTERNAL void compile (hb_ot_shape_plan_t           &plan,
-			    const hb_ot_shape_plan_key_t &key);
+			    const hb_ot_shape_plan_key_t &key,
+			    const hb_ot_map_t            *base_map = nullptr);
 };
 
 
@@ -68,15 +68,18 @@ hb_syllabic_insert_dotted_circles (hb_font_t *font,
 
   buffer->clear_output ();
 
+  /* Syllable serials wrap around, so compare each syllable with the one
+   * right before it, not with the last broken one; otherwise a broken
+   * syllable fifteen syllables after another gets no dotted circle. */
   buffer->idx = 0;
   unsigned int last_syllable = 0;
   while (buffer->idx < buffer->len && buffer->successful)
   {
     unsigned int syllable = buffer->cur().syllable();
-    if (unlikely (last_syllable != syllable && (syllable & 0x0F) == broken_syllable_type))
+    bool syllable_start = last_syllable != syllable;
+    last_syllable = syllable;
+    if (unlikely (syllable_start && (syllable & 0x0F) == broken_syllable_type))
     {
-      last_syllable = syllable;
-
       hb_glyph_info_t ginfo = dottedcircle;
       ginfo.cluster = buffer->cur().cluster;
       ginfo.mask = buffer->cur().mask;
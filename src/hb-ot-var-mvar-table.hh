@@ -74,7 +74,8 @@ struct MVAR
   }
 
   float get_var (hb_tag_t tag,
-		 const int *coords, unsigned int coord_count) const
+		 const int *coords, unsigned int coord_count,
+		 VariationStore::cache_t *cache = nullptr) const
   {
     const VariationValueRecord *record;
     record = (VariationValueRecord *) hb_bsearch (tag,
@@ -85,7 +86,21 @@ struct MVAR
     if (!record)
       return 0.;
 
-    return (this+varStore).get_delta (record->varIdx, coords, coord_count);
+    return (this+varStore).get_delta (record->varIdx, coords, coord_count, cache);
+  }
+
+  /* Returns the cache of the VariationStore for the current coordinates
+   * of @font, or nullptr. */
+  const VariationStore::font_cache_t *get_var_cache (hb_font_t *font) const
+  { return (this+varStore).get_font_cache (font, HB_FONT_VAR_STORE_MVAR, false); }
+
+  /* Like above, at the coordinates of @font, sharing the region scalars
+   * with other lookups on the same font. */
+  float get_var (hb_tag_t tag, hb_font_t *font) const
+  {
+    const VariationStore::font_cache_t *cache = get_var_cache (font);
+    return get_var (tag, font->coords, font->num_coords,
+		    cache ? cache->scalars : nullptr);
   }
 
 protected:
@@ -0,0 +1,802 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb.hh"
+#include "hb-shape-split.hh"
+#include "hb-map.hh"
+#include "hb-mutex.hh"
+
+
+/**
+ * SECTION:hb-shape-cache
+ * @title: hb-shape-cache
+ * @short_description: Caching of shaping results
+ * @include: hb.h
+ *
+ * A shape cache memoizes the shaping results of short runs of text.
+ *
+ * hb_shape_cached() splits the text of a buffer into words, at the
+ * boundaries following spaces, and looks each word up in the cache
+ * before shaping it.  Words are shaped on their own, and their glyphs
+ * are only concatenated where neither side carries the
+ * #HB_GLYPH_FLAG_UNSAFE_TO_CONCAT flag at the joint; otherwise the
+ * neighbouring words are shaped together.  The result is the same as
+ * shaping the whole buffer with hb_shape_full().
+ *
+ * Clients that shape the same words over and over again, for example
+ * text-layout services, can use a shape cache to skip most of the
+ * shaping work.
+ **/
+
+
+#ifndef HB_SHAPE_CACHE_MAX_RUN_LENGTH
+#define HB_SHAPE_CACHE_MAX_RUN_LENGTH 64
+#endif
+
+
+/*
+ * hb_shape_cache_key_t
+ */
+
+struct hb_shape_cache_key_t
+{
+  hb_font_t *font;
+  unsigned int font_serial;
+  hb_shape_plan_t *shape_plan;
+  /* Buffer settings, followed by the pre-context, post-context and
+   * text of the run. */
+  hb_vector_t<uint32_t> data;
+
+  uint32_t hash () const
+  {
+    uint32_t h = hb_hash ((uintptr_t) font);
+    h = h * 31 + font_serial;
+    h = h * 31 + hb_hash ((uintptr_t) shape_plan);
+    for (uint32_t v : data)
+      h = h * 31 + v;
+    return h;
+  }
+
+  bool operator == (const hb_shape_cache_key_t &other) const
+  {
+    return font == other.font &&
+	   font_serial == other.font_serial &&
+	   shape_plan == other.shape_plan &&
+	   data.as_array () == other.data.as_array ();
+  }
+};
+
+struct hb_shape_cache_entry_t
+{
+  hb_shape_cache_key_t key; /* Holds references to font and shape_plan. */
+  uint32_t hash; /* Of key. */
+  unsigned int next; /* Next entry with the same hash, or -1. */
+  hb_vector_t<hb_glyph_info_t> info; /* Clusters relative to run start. */
+  hb_vector_t<hb_glyph_position_t> pos;
+  bool referenced;
+
+  void fini ()
+  {
+    hb_font_destroy (key.font);
+    hb_shape_plan_destroy (key.shape_plan);
+    key.data.fini ();
+    info.fini ();
+    pos.fini ();
+  }
+};
+
+
+/*
+ * hb_shape_cache_t
+ *
+ * Size-bounded cache of shaped runs.  Runs are found by hashing their
+ * key, and evicted using the CLOCK (second-chance) algorithm once the
+ * cache is full, like hb_shape_plan_cache_t.
+ *
+ * The map only holds hashes, each leading to the chain of entries with
+ * that hash; keys are only ever compared to those of live entries.
+ */
+
+struct hb_shape_cache_t
+{
+  hb_object_header_t header;
+
+  hb_mutex_t lock;
+  hb_hashmap_t<uint32_t, unsigned int, true> map; /* Hash to first index into entries. */
+  hb_vector_t<hb_shape_cache_entry_t *> entries;
+  unsigned int capacity;
+  unsigned int hand;
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int evictions;
+
+  void init (unsigned int max_entries)
+  {
+    lock.init ();
+    map.init ();
+    entries.init ();
+    capacity = max_entries;
+    hand = 0;
+    hits = misses = evictions = 0;
+  }
+  void fini ()
+  {
+    clear ();
+    entries.fini ();
+    map.fini ();
+    lock.fini ();
+  }
+
+  /* Appends the glyphs of the matching run, with clusters offset
+   * by cluster_offset, to info and pos.  Returns false on a miss. */
+  bool lookup (const hb_shape_cache_key_t *key,
+	       unsigned int cluster_offset,
+	       hb_vector_t<hb_glyph_info_t> &info,
+	       hb_vector_t<hb_glyph_position_t> &pos)
+  {
+    uint32_t hash = key->hash ();
+
+    hb_lock_t l (lock);
+
+    unsigned int i = find (key, hash);
+    if (i == (unsigned int) -1)
+    {
+      misses++;
+      return false;
+    }
+
+    const hb_shape_cache_entry_t *entry = entries[i];
+    unsigned int start = info.length;
+    if (unlikely (!info.resize (start + entry->info.length) ||
+		  !pos.resize (start + entry->pos.length)))
+    {
+      info.shrink (start);
+      pos.shrink (start);
+      return false;
+    }
+    hits++;
+    entries[i]->referenced = true;
+
+    for (unsigned int j = 0; j < entry->info.length; j++)
+    {
+      info[start + j] = entry->info[j];
+      info[start + j].cluster += cluster_offset;
+    }
+    hb_memcpy (&pos[start], entry->pos.arrayZ, entry->pos.length * sizeof (pos[0]));
+    return true;
+  }
+
+  void insert (const hb_shape_cache_key_t *key,
+	       hb_array_t<const hb_glyph_info_t> info,
+	       hb_array_t<const hb_glyph_position_t> pos)
+  {
+    if (unlikely (!capacity))
+      return;
+
+    hb_shape_cache_entry_t *entry = (hb_shape_cache_entry_t *) hb_calloc (1, sizeof (hb_shape_cache_entry_t));
+    if (unlikely (!entry))
+      return;
+    if (unlikely (!entry->key.data.resize (key->data.length) ||
+		  !entry->info.resize (info.length) ||
+		  !entry->pos.resize (pos.length)))
+    {
+      entry->key.data.fini ();
+      entry->info.fini ();
+      entry->pos.fini ();
+      hb_free (entry);
+      return;
+    }
+    entry->hash = key->hash ();
+    entry->key.font = hb_font_reference (key->font);
+    entry->key.font_serial = key->font_serial;
+    entry->key.shape_plan = hb_shape_plan_reference (key->shape_plan);
+    hb_memcpy (entry->key.data.arrayZ, key->data.arrayZ, key->data.length * sizeof (key->data[0]));
+    hb_memcpy (entry->info.arrayZ, info.arrayZ, info.length * sizeof (info[0]));
+    hb_memcpy (entry->pos.arrayZ, pos.arrayZ, pos.length * sizeof (pos[0]));
+
+    hb_lock_t l (lock);
+
+    /* Another thread might have beaten us to it. */
+    unsigned int i = find (key, entry->hash);
+    if (i != (unsigned int) -1)
+    {
+      entries[i]->referenced = true;
+      goto fail;
+    }
+
+    if (entries.length < capacity)
+    {
+      i = entries.length;
+      if (unlikely (!entries.push (nullptr)))
+	goto fail;
+    }
+    else
+    {
+      /* CLOCK: Give recently used runs a second chance. */
+      while (entries[hand]->referenced)
+      {
+	entries[hand]->referenced = false;
+	hand = (hand + 1) % entries.length;
+      }
+      i = hand;
+      hand = (hand + 1) % entries.length;
+      evict (i);
+    }
+
+    entry->next = map.get (entry->hash);
+    if (unlikely (map.in_error () || !map.set (entry->hash, i)))
+    {
+      /* The chains cannot be trusted anymore; start over. */
+      clear ();
+      goto fail;
+    }
+    entries[i] = entry;
+    return;
+
+  fail:
+    entry->fini ();
+    hb_free (entry);
+  }
+
+  void get_stats (unsigned int *hits_out,
+		  unsigned int *misses_out,
+		  unsigned int *evictions_out)
+  {
+    hb_lock_t l (lock);
+    if (hits_out) *hits_out = hits;
+    if (misses_out) *misses_out = misses;
+    if (evictions_out) *evictions_out = evictions;
+  }
+
+  private:
+  unsigned int find (const hb_shape_cache_key_t *key, uint32_t hash) const
+  {
+    unsigned int i = map.get (hash);
+    while (i != (unsigned int) -1 && !(entries[i]->key == *key))
+      i = entries[i]->next;
+    return i;
+  }
+
+  /* Frees all entries; the slot being filled by insert() may be nullptr. */
+  void clear ()
+  {
+    for (hb_shape_cache_entry_t *entry : entries)
+    {
+      if (!entry)
+	continue;
+      entry->fini ();
+      hb_free (entry);
+    }
+    entries.shrink (0);
+    map.reset ();
+    hand = 0;
+  }
+
+  /* Unlinks entry i from the chain of its hash, and frees it. */
+  void evict (unsigned int i)
+  {
+    hb_shape_cache_entry_t *entry = entries[i];
+    unsigned int *link = nullptr;
+    unsigned int j = map.get (entry->hash);
+    while (j != i)
+    {
+      link = &entries[j]->next;
+      j = *link;
+    }
+    if (link)
+      *link = entry->next;
+    else if (entry->next == (unsigned int) -1)
+      map.del (entry->hash);
+    else
+      map.set (entry->hash, entry->next); /* On failure, insert() clears. */
+    entry->fini ();
+    hb_free (entry);
+    entries[i] = nullptr;
+    evictions++;
+  }
+};
+
+
+/*
+ * hb_shape_cache_context_t
+ *
+ * State for shaping one buffer through the cache.
+ */
+
+struct hb_shape_cache_context_t
+{
+  struct piece_t
+  {
+    unsigned int start; /* Text range. */
+    unsigned int end;
+    unsigned int glyph_start; /* Glyph range in info and pos. */
+    unsigned int glyph_end;
+    bool head_unsafe;
+    bool tail_unsafe;
+  };
+
+  hb_shape_cache_t *cache;
+  hb_font_t *font;
+  hb_buffer_t *buffer;
+  const hb_feature_t *features;
+  unsigned int num_features;
+  hb_shape_plan_t *shape_plan;
+  bool split_words;
+  hb_buffer_t *scratch;
+
+  hb_vector_t<hb_codepoint_t> text;
+  hb_vector_t<uint32_t> clusters;
+  hb_shape_cache_key_t key;
+
+  /* Shaped words and pieces, in logical order, and their glyphs. */
+  hb_vector_t<piece_t> words;
+  hb_vector_t<piece_t> pieces;
+  hb_vector_t<hb_glyph_info_t> info;
+  hb_vector_t<hb_glyph_position_t> pos;
+
+  hb_shape_cache_context_t (hb_shape_cache_t   *cache_,
+			    hb_font_t          *font_,
+			    hb_buffer_t        *buffer_,
+			    const hb_feature_t *features_,
+			    unsigned int        num_features_,
+			    hb_shape_plan_t    *shape_plan_,
+			    bool                split_words_) :
+			    cache (cache_),
+			    font (font_),
+			    buffer (buffer_),
+			    features (features_),
+			    num_features (num_features_),
+			    shape_plan (shape_plan_),
+			    split_words (split_words_),
+			    scratch (hb_buffer_create_similar (buffer_))
+  {
+    key.font = font;
+    key.font_serial = font->serial;
+    key.shape_plan = shape_plan;
+  }
+  ~hb_shape_cache_context_t () { hb_buffer_destroy (scratch); }
+
+  hb_buffer_flags_t run_flags (unsigned int start, unsigned int end) const
+  {
+    unsigned int flags = buffer->flags | HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT;
+    if (start)
+      flags &= ~HB_BUFFER_FLAG_BOT;
+    if (end < text.length)
+      flags &= ~HB_BUFFER_FLAG_EOT;
+    return (hb_buffer_flags_t) flags;
+  }
+
+  bool make_key (unsigned int start, unsigned int end)
+  {
+    unsigned int pre_len = start ? 0 : buffer->context_len[0];
+    unsigned int post_len = end < text.length ? 0 : buffer->context_len[1];
+
+    hb_vector_t<uint32_t> &data = key.data;
+    data.resize (0);
+    data.push (run_flags (start, end));
+    data.push (buffer->cluster_level);
+    data.push (buffer->invisible);
+    data.push (buffer->replacement);
+    data.push (buffer->not_found);
+    data.push (pre_len);
+    for (unsigned int i = 0; i < pre_len; i++)
+      data.push (buffer->context[0][i]);
+    data.push (post_len);
+    for (unsigned int i = 0; i < post_len; i++)
+      data.push (buffer->context[1][i]);
+    for (unsigned int i = start; i < end; i++)
+      data.push (text[i]);
+    return !data.in_error ();
+  }
+
+  bool shape_scratch (unsigned int start, unsigned int end)
+  {
+    hb_buffer_clear_contents (scratch);
+    scratch->props = buffer->props;
+    scratch->flags = run_flags (start, end);
+    for (unsigned int i = start; i < end; i++)
+      scratch->add (text[i], i - start);
+    if (unlikely (!scratch->successful))
+      return false;
+    scratch->content_type = HB_BUFFER_CONTENT_TYPE_UNICODE;
+    if (!start)
+    {
+      hb_memcpy (scratch->context[0], buffer->context[0], sizeof (buffer->context[0]));
+      scratch->context_len[0] = buffer->context_len[0];
+    }
+    if (end == text.length)
+    {
+      hb_memcpy (scratch->context[1], buffer->context[1], sizeof (buffer->context[1]));
+      scratch->context_len[1] = buffer->context_len[1];
+    }
+
+    scratch->enter ();
+    bool res = hb_shape_plan_execute (shape_plan, font, scratch, features, num_features);
+    if (scratch->max_ops <= 0)
+      scratch->shaping_failed = true;
+    scratch->leave ();
+
+    return res && scratch->successful && !scratch->shaping_failed;
+  }
+
+  /* Shapes text[start:end] and appends its glyphs. */
+  bool shape_run (unsigned int start, unsigned int end, piece_t *piece)
+  {
+    piece->start = start;
+    piece->end = end;
+    piece->glyph_start = info.length;
+
+    bool cacheable = end - start <= HB_SHAPE_CACHE_MAX_RUN_LENGTH && make_key (start, end);
+    if (!(cacheable && cache->lookup (&key, start, info, pos)))
+    {
+      if (unlikely (!shape_scratch (start, end)))
+	return false;
+
+      unsigned int count = scratch->len;
+      if (cacheable)
+	cache->insert (&key,
+		       hb_array (scratch->info, count),
+		       hb_array (scratch->pos, count));
+
+      if (unlikely (!info.resize (piece->glyph_start + count) ||
+		    !pos.resize (piece->glyph_start + count)))
+	return false;
+      for (unsigned int i = 0; i < count; i++)
+      {
+	info[piece->glyph_start + i] = scratch->info[i];
+	info[piece->glyph_start + i].cluster += start;
+      }
+      hb_memcpy (&pos[piece->glyph_start], scratch->pos, count * sizeof (pos[0]));
+    }
+
+    piece->glyph_end = info.length;
+
+    _hb_shape_split_get_edges (info.as_array ().sub_array (piece->glyph_start),
+			       &piece->head_unsafe, &piece->tail_unsafe);
+    return true;
+  }
+
+  bool shape ()
+  {
+    unsigned int count = buffer->len;
+    if (unlikely (!text.resize (count) || !clusters.resize (count)))
+      return false;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      text[i] = buffer->info[i].codepoint;
+      clusters[i] = buffer->info[i].cluster;
+    }
+
+    /* Shape each word on its own.  Words start after spaces, such that
+     * they carry their trailing spaces. */
+    unsigned int start = 0;
+    for (unsigned int end = 1; end <= count; end++)
+    {
+      if (end < count && !(split_words && _hb_shape_split_is_word_start (buffer->unicode, text[end - 1], text[end])))
+	continue;
+
+      piece_t word;
+      if (unlikely (!shape_run (start, end, &word)))
+	return false;
+      words.push (word);
+
+      start = end;
+    }
+    if (unlikely (words.in_error ()))
+      return false;
+
+    /* Where either side of a joint is unsafe to concat, shape the words
+     * around it together instead.  Check the joints of the combined
+     * pieces again, until they are all safe. */
+    for (unsigned int i = 0; i < words.length;)
+    {
+      unsigned int j = i + 1;
+      while (j < words.length && (words[j - 1].tail_unsafe || words[j].head_unsafe))
+	j++;
+
+      piece_t piece = words[i];
+      if (j > i + 1)
+      {
+	/* Give up on text that does not split well. */
+	if (words[j - 1].end - words[i].start > HB_SHAPE_CACHE_MAX_RUN_LENGTH)
+	  return false;
+	if (unlikely (!shape_run (words[i].start, words[j - 1].end, &piece)))
+	  return false;
+      }
+      i = j;
+
+      while (pieces.length &&
+	     (pieces.tail ().tail_unsafe || piece.head_unsafe))
+      {
+	piece_t prev = pieces.pop ();
+	if (piece.end - prev.start > HB_SHAPE_CACHE_MAX_RUN_LENGTH)
+	  return false;
+	if (unlikely (!shape_run (prev.start, piece.end, &piece)))
+	  return false;
+      }
+      pieces.push (piece);
+    }
+    if (unlikely (pieces.in_error ()))
+      return false;
+
+    return assemble ();
+  }
+
+  bool assemble ()
+  {
+    unsigned int count = 0;
+    for (const piece_t &piece : pieces)
+      count += piece.glyph_end - piece.glyph_start;
+    if (unlikely (!buffer->ensure (count)))
+      return false;
+
+    bool forward = HB_DIRECTION_IS_FORWARD (buffer->props.direction);
+    unsigned int j = 0;
+    for (unsigned int p = 0; p < pieces.length; p++)
+    {
+      const piece_t &piece = pieces[forward ? p : pieces.length - 1 - p];
+      for (unsigned int i = piece.glyph_start; i < piece.glyph_end; i++)
+      {
+	hb_glyph_info_t &g = buffer->info[j];
+	g = info[i];
+	g.cluster = clusters[g.cluster];
+	_hb_shape_split_fixup_flags (buffer->flags, g);
+	buffer->pos[j] = pos[i];
+	j++;
+      }
+    }
+
+    buffer->len = count;
+    buffer->content_type = HB_BUFFER_CONTENT_TYPE_GLYPHS;
+    buffer->have_positions = true;
+    buffer->shaping_failed = false;
+    return true;
+  }
+};
+
+static bool
+_hb_shape_cache_can_segment (hb_shape_cache_t   *cache,
+			     hb_buffer_t        *buffer,
+			     const hb_feature_t *features,
+			     unsigned int        num_features)
+{
+  if (!hb_object_is_valid (cache) || !cache->capacity)
+    return false;
+
+  /* The key does not cover the Unicode functions. */
+  if (buffer->unicode != hb_unicode_funcs_get_default ())
+    return false;
+
+  /* Words found in the cache would send no messages.  And words shaped
+   * alone can be unsafe to concat where the whole text is not. */
+  if (buffer->messaging () ||
+      (buffer->flags & HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT))
+    return false;
+
+  return _hb_shape_split_buffer_is_splittable (buffer, features, num_features);
+}
+
+
+/*
+ * hb_shape_cache_t
+ */
+
+
+/**
+ * hb_shape_cache_create:
+ * @max_entries: The maximum number of shaped runs to keep
+ *
+ * Creates a new shape cache holding up to @max_entries shaped runs.
+ * Each run is at most a few dozen characters long, which bounds the
+ * memory used by the cache.  Once full, the least recently used runs
+ * are evicted.
+ *
+ * Cached runs hold a reference to the font they were shaped with,
+ * which is released when they get evicted or the cache is destroyed.
+ *
+ * Return value: (transfer full): The new shape cache
+ *
+ * Since: REPLACEME
+ **/
+hb_shape_cache_t *
+hb_shape_cache_create (unsigned int max_entries)
+{
+  hb_shape_cache_t *cache;
+
+  if (!(cache = hb_object_create<hb_shape_cache_t> ()))
+    return const_cast<hb_shape_cache_t *> (&Null (hb_shape_cache_t));
+
+  cache->init (max_entries);
+
+  return cache;
+}
+
+/**
+ * hb_shape_cache_reference: (skip)
+ * @cache: A shape cache
+ *
+ * Increases the reference count on the given shape cache.
+ *
+ * Return value: (transfer full): @cache
+ *
+ * Since: REPLACEME
+ **/
+hb_shape_cache_t *
+hb_shape_cache_reference (hb_shape_cache_t *cache)
+{
+  return hb_object_reference (cache);
+}
+
+/**
+ * hb_shape_cache_destroy: (skip)
+ * @cache: A shape cache
+ *
+ * Decreases the reference count on the given shape cache. When the
+ * reference count reaches zero, the shape cache is destroyed,
+ * freeing all memory.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_shape_cache_destroy (hb_shape_cache_t *cache)
+{
+  if (!hb_object_destroy (cache)) return;
+
+  cache->fini ();
+  hb_free (cache);
+}
+
+/**
+ * hb_shape_cache_set_user_data: (skip)
+ * @cache: A shape cache
+ * @key: The user-data key to set
+ * @data: A pointer to the user data
+ * @destroy: (nullable): A callback to call when @data is not needed anymore
+ * @replace: Whether to replace an existing data with the same key
+ *
+ * Attaches a user-data key/data pair to the given shape cache.
+ *
+ * Return value: %true if success, %false otherwise.
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_shape_cache_set_user_data (hb_shape_cache_t   *cache,
+			      hb_user_data_key_t *key,
+			      void *              data,
+			      hb_destroy_func_t   destroy,
+			      hb_bool_t           replace)
+{
+  return hb_object_set_user_data (cache, key, data, destroy, replace);
+}
+
+/**
+ * hb_shape_cache_get_user_data: (skip)
+ * @cache: A shape cache
+ * @key: The user-data key to query
+ *
+ * Fetches the user data associated with the specified key,
+ * attached to the specified shape cache.
+ *
+ * Return value: (transfer none): A pointer to the user data
+ *
+ * Since: REPLACEME
+ **/
+void *
+hb_shape_cache_get_user_data (hb_shape_cache_t   *cache,
+			      hb_user_data_key_t *key)
+{
+  return hb_object_get_user_data (cache, key);
+}
+
+/**
+ * hb_shape_cache_get_stats:
+ * @cache: A shape cache
+ * @hits: (out) (optional): Number of runs found in the cache
+ * @misses: (out) (optional): Number of runs not found in the cache
+ * @evictions: (out) (optional): Number of runs evicted from the cache
+ *
+ * Fetches the statistics of @cache, accumulated since it was created.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_shape_cache_get_stats (hb_shape_cache_t *cache,
+			  unsigned int     *hits,
+			  unsigned int     *misses,
+			  unsigned int     *evictions)
+{
+  if (unlikely (!hb_object_is_valid (cache)))
+  {
+    if (hits) *hits = 0;
+    if (misses) *misses = 0;
+    if (evictions) *evictions = 0;
+    return;
+  }
+
+  cache->get_stats (hits, misses, evictions);
+}
+
+/**
+ * hb_shape_cached:
+ * @cache: A shape cache
+ * @font: an #hb_font_t to use for shaping
+ * @buffer: an #hb_buffer_t to shape
+ * @features: (array length=num_features) (nullable): an array of user
+ *    specified #hb_feature_t or %NULL
+ * @num_features: the length of @features array
+ * @shaper_list: (array zero-terminated=1) (nullable): a %NULL-terminated
+ *    array of shapers to use or %NULL
+ *
+ * Shapes @buffer like hb_shape_full() does, reusing the shaping results
+ * of words found in @cache, and adding newly shaped words to it.
+ *
+ * Cached results are keyed on @font, its serial number as returned by
+ * hb_font_get_serial(), the shape plan for the buffer properties and
+ * @features, the buffer flags and the text.  Buffers with ranged
+ * features, non-increasing cluster values, custom Unicode functions, a
+ * message function, or the #HB_BUFFER_FLAG_VERIFY or
+ * #HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT flags are shaped without the
+ * cache.
+ *
+ * Return value: false if all shapers failed, true otherwise
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_shape_cached (hb_shape_cache_t   *cache,
+		 hb_font_t          *font,
+		 hb_buffer_t        *buffer,
+		 const hb_feature_t *features,
+		 unsigned int        num_features,
+		 const char * const *shaper_list)
+{
+  if (unlikely (!buffer->len))
+    return true;
+
+  if (!_hb_shape_cache_can_segment (cache, buffer, features, num_features))
+    return hb_shape_full (font, buffer, features, num_features, shaper_list);
+
+  hb_shape_plan_t *shape_plan = hb_shape_plan_create_cached2 (font->face, &buffer->props,
+							      features, num_features,
+							      font->coords, font->num_coords,
+							      shaper_list);
+
+  bool ret = false;
+  bool split_words = _hb_shape_split_plan_reports_concat (shape_plan) &&
+		     _hb_shape_split_space_is_inert (shape_plan, font);
+  if (split_words || buffer->len <= HB_SHAPE_CACHE_MAX_RUN_LENGTH)
+  {
+    hb_shape_cache_context_t c (cache, font, buffer, features, num_features, shape_plan, split_words);
+    ret = c.shape ();
+  }
+
+  hb_shape_plan_destroy (shape_plan);
+
+  /* Fall back to shaping the whole buffer. */
+  if (!ret)
+    return hb_shape_full (font, buffer, features, num_features, shaper_list);
+
+  return true;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#if !defined(HB_H_IN) && !defined(HB_NO_SINGLE_HEADER_ERROR)
+#error "Include <hb.h> instead."
+#endif
+
+#ifndef HB_SHAPE_CACHE_H
+#define HB_SHAPE_CACHE_H
+
+#include "hb-common.h"
+#include "hb-buffer.h"
+#include "hb-font.h"
+
+HB_BEGIN_DECLS
+
+/**
+ * hb_shape_cache_t:
+ *
+ * Data type for holding a cache of shaping results.
+ *
+ * A shape cache remembers the glyphs and positions produced for short
+ * runs of text (typically words), keyed on the font, the shaping plan
+ * and the text itself, so that shaping text that repeats the same
+ * words can skip most of the work.  Cached runs are only stitched
+ * together where the shaper reported it safe to do so.
+ *
+ * Shape caches are thread-safe and can be shared between threads.
+ **/
+typedef struct hb_shape_cache_t hb_shape_cache_t;
+
+HB_EXTERN hb_shape_cache_t *
+hb_shape_cache_create (unsigned int max_entries);
+
+HB_EXTERN hb_shape_cache_t *
+hb_shape_cache_reference (hb_shape_cache_t *cache);
+
+HB_EXTERN void
+hb_shape_cache_destroy (hb_shape_cache_t *cache);
+
+HB_EXTERN hb_bool_t
+hb_shape_cache_set_user_data (hb_shape_cache_t   *cache,
+			      hb_user_data_key_t *key,
+			      void *              data,
+			      hb_destroy_func_t   destroy,
+			      hb_bool_t           replace);
+
+HB_EXTERN void *
+hb_shape_cache_get_user_data (hb_shape_cache_t   *cache,
+			      hb_user_data_key_t *key);
+
+HB_EXTERN void
+hb_shape_cache_get_stats (hb_shape_cache_t *cache,
+			  unsigned int     *hits,      /* OUT */
+			  unsigned int     *misses,    /* OUT */
+			  unsigned int     *evictions  /* OUT */);
+
+HB_EXTERN hb_bool_t
+hb_shape_cached (hb_shape_cache_t   *cache,
+		 hb_font_t          *font,
+		 hb_buffer_t        *buffer,
+		 const hb_feature_t *features,
+		 unsigned int        num_features,
+		 const char * const *shaper_list);
+
+
+HB_END_DECLS
+
+#endif /* HB_SHAPE_CACHE_H */
@@ -0,0 +1,338 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb.hh"
+#include "hb-shape-split.hh"
+#include "hb-utf.hh"
+
+
+/*
+ * hb_shape_edit_context_t
+ *
+ * State for reshaping the text around an edit.
+ *
+ * The text from start to end, in old text positions, is reshaped as an
+ * hb_shape_split_run_t of the new text, and its glyphs replace those of
+ * the old.  Both ends must be safe to break in the old glyphs and in
+ * the new ones, and far enough from the edit that the text the old
+ * glyphs were shaped with, context included, did not change.  Where
+ * they are not, the range grows until they are.
+ */
+
+struct hb_shape_edit_context_t
+{
+  hb_font_t *font;
+  hb_buffer_t *buffer; /* Glyphs of the old text. */
+  hb_buffer_t *text; /* New text. */
+  const hb_feature_t *features;
+  unsigned int num_features;
+  hb_shape_plan_t *shape_plan;
+
+  unsigned int old_len; /* Length of the old text. */
+  int delta; /* Change in length. */
+
+  hb_shape_split_run_t run;
+
+  hb_shape_edit_context_t (hb_font_t          *font_,
+			   hb_buffer_t        *buffer_,
+			   hb_buffer_t        *text_,
+			   const hb_feature_t *features_,
+			   unsigned int        num_features_,
+			   hb_shape_plan_t    *shape_plan_,
+			   unsigned int        old_len_) :
+			   font (font_),
+			   buffer (buffer_),
+			   text (text_),
+			   features (features_),
+			   num_features (num_features_),
+			   shape_plan (shape_plan_),
+			   old_len (old_len_),
+			   delta ((int) text_->len - (int) old_len_),
+			   run () {}
+  ~hb_shape_edit_context_t () { run.fini (); }
+
+  /* Glyphs in logical order.  Clusters are monotone. */
+  unsigned int cluster (unsigned int i) const
+  {
+    bool forward = HB_DIRECTION_IS_FORWARD (buffer->props.direction);
+    return buffer->info[forward ? i : buffer->len - 1 - i].cluster;
+  }
+  /* Number of old glyphs before text position i. */
+  unsigned int glyphs_before (unsigned int i) const
+  {
+    unsigned int lo = 0, hi = buffer->len;
+    while (lo < hi)
+    {
+      unsigned int mid = lo + (hi - lo) / 2;
+      if (cluster (mid) < i)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+    return lo;
+  }
+  /* Whether the old glyphs are safe to break at text position i. */
+  bool is_safe_to_break (unsigned int i) const
+  {
+    if (!i || i >= old_len)
+      return true;
+    unsigned int j = glyphs_before (i);
+    if (j == buffer->len || cluster (j) != i)
+      return false;
+    bool forward = HB_DIRECTION_IS_FORWARD (buffer->props.direction);
+    return !(buffer->info[forward ? j : buffer->len - 1 - j].mask & HB_GLYPH_FLAG_UNSAFE_TO_BREAK);
+  }
+
+  bool shape (unsigned int offset, unsigned int removed_length)
+  {
+    const unsigned int context_length = hb_buffer_t::CONTEXT_LENGTH;
+
+    unsigned int start = offset > context_length ? offset - context_length : 0;
+    unsigned int end = hb_min (old_len, offset + removed_length + context_length);
+    while (!is_safe_to_break (start)) start--;
+    while (!is_safe_to_break (end)) end++;
+
+    for (;;)
+    {
+      run.fini ();
+      run.start = start;
+      run.end = end + delta;
+      run.shape (shape_plan, font, text, features, num_features);
+      if (unlikely (!run.success))
+	return false;
+      if (!run.head_unsafe && !run.tail_unsafe)
+	break;
+
+      /* Grow geometrically, to bound the number of retries. */
+      unsigned int grow = hb_max (end - start, context_length);
+      if (run.head_unsafe)
+      {
+	start = start > grow ? start - grow : 0;
+	while (!is_safe_to_break (start)) start--;
+      }
+      if (run.tail_unsafe)
+      {
+	end = hb_min (old_len, end + grow);
+	while (!is_safe_to_break (end)) end++;
+      }
+    }
+
+    return splice (start, end);
+  }
+
+  /* Replaces the old glyphs of text[start:end] with those of the run,
+   * and moves the clusters after them. */
+  bool splice (unsigned int start, unsigned int end)
+  {
+    unsigned int old_count = buffer->len;
+    unsigned int glyph_start = glyphs_before (start);
+    unsigned int glyph_end = glyphs_before (end);
+    unsigned int removed = glyph_end - glyph_start;
+    unsigned int inserted = run.glyph_end - run.glyph_start;
+    unsigned int count = old_count - removed + inserted;
+    if (unlikely (!buffer->ensure (count)))
+      return false;
+
+    bool forward = HB_DIRECTION_IS_FORWARD (buffer->props.direction);
+    unsigned int i = forward ? glyph_start : old_count - glyph_end;
+    unsigned int tail = old_count - i - removed;
+    memmove (buffer->info + i + inserted, buffer->info + i + removed, tail * sizeof (buffer->info[0]));
+    memmove (buffer->pos + i + inserted, buffer->pos + i + removed, tail * sizeof (buffer->pos[0]));
+    hb_memcpy (buffer->info + i, run.buffer->info + run.glyph_start, inserted * sizeof (buffer->info[0]));
+    hb_memcpy (buffer->pos + i, run.buffer->pos + run.glyph_start, inserted * sizeof (buffer->pos[0]));
+    buffer->len = count;
+
+    unsigned int moved_start = forward ? i + inserted : 0;
+    unsigned int moved_end = forward ? count : i;
+    for (unsigned int j = moved_start; j < moved_end; j++)
+      buffer->info[j].cluster += delta;
+
+    return true;
+  }
+};
+
+/* Whether the glyphs in buffer can be edited in place, rather than
+ * shaping the edited text anew. */
+static bool
+_hb_shape_edit_is_incremental (hb_buffer_t        *buffer,
+			       hb_buffer_t        *text,
+			       const hb_feature_t *features,
+			       unsigned int        num_features)
+{
+  /* Lookups running into the end of the run can mark glyphs unsafe to
+   * concat that would not be when shaping the whole text. */
+  if (buffer->content_type != HB_BUFFER_CONTENT_TYPE_GLYPHS ||
+      !buffer->have_positions ||
+      !buffer->len ||
+      buffer->props.direction != text->props.direction ||
+      (text->cluster_level != HB_BUFFER_CLUSTER_LEVEL_MONOTONE_GRAPHEMES &&
+       text->cluster_level != HB_BUFFER_CLUSTER_LEVEL_MONOTONE_CHARACTERS) ||
+      (text->flags & HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT) ||
+      text->messaging () ||
+      !_hb_shape_split_buffer_is_splittable (text, features, num_features))
+    return false;
+
+  for (unsigned int i = 0; i < text->len; i++)
+    if (text->info[i].cluster != i)
+      return false;
+
+  return true;
+}
+
+/* Applies the edit to text, numbering clusters by position. */
+static bool
+_hb_shape_edit_text (hb_buffer_t    *text,
+		     unsigned int    offset,
+		     unsigned int    removed_length,
+		     const uint32_t *inserted,
+		     unsigned int    inserted_length)
+{
+  unsigned int old_len = text->len;
+  unsigned int len = old_len - removed_length + inserted_length;
+  if (unlikely (len < inserted_length || !text->ensure (len)))
+    return false;
+
+  memmove (text->info + offset + inserted_length,
+	   text->info + offset + removed_length,
+	   (old_len - offset - removed_length) * sizeof (text->info[0]));
+  const uint32_t *end = inserted + inserted_length;
+  for (unsigned int i = offset; inserted < end; i++)
+  {
+    hb_codepoint_t u;
+    inserted = hb_utf32_t::next (inserted, end, &u, text->replacement);
+    hb_glyph_info_t *info = &text->info[i];
+    hb_memset (info, 0, sizeof (*info));
+    info->codepoint = u;
+  }
+  text->len = len;
+
+  for (unsigned int i = 0; i < len; i++)
+    text->info[i].cluster = i;
+
+  return true;
+}
+
+/**
+ * hb_shape_edit:
+ * @font: an #hb_font_t to use for shaping
+ * @buffer: (inout): an #hb_buffer_t holding @text shaped with @font and
+ *    @features
+ * @text: (inout): an #hb_buffer_t holding the text that was shaped
+ * @offset: the position in @text of the first character to remove
+ * @removed_length: the number of characters to remove
+ * @inserted: (array length=inserted_length): UTF-32 characters to
+ *    insert at @offset
+ * @inserted_length: the length of @inserted, or -1 if it is %NULL
+ *    terminated
+ * @features: (array length=num_features) (nullable): an array of user
+ *    specified #hb_feature_t or %NULL
+ * @num_features: the length of @features array
+ * @shaper_list: (array zero-terminated=1) (nullable): a %NULL-terminated
+ *    array of shapers to use or %NULL
+ *
+ * Edits @text, replacing @removed_length characters at @offset with
+ * @inserted, and updates its shaping in @buffer to match.  This is the
+ * same as shaping the edited text with hb_shape_full(), only faster:
+ * just the text around the edit is shaped again, up to where the old
+ * and the new glyphs are both safe to break.  The glyphs of that text
+ * replace the old ones, and the cluster values of the glyphs after it
+ * move along.  For small edits the time taken depends on the size of
+ * the edit, not on the length of @text.
+ *
+ * The cluster values of @text must be the positions of its characters,
+ * such as hb_buffer_add_utf32() and hb_buffer_add_codepoints() set when
+ * adding the whole text, and stay so after the edit.  Insertions are
+ * validated like hb_buffer_add_utf32() does.  The segment properties,
+ * flags and other settings of @text are the ones shaped with.  @buffer
+ * must hold the output of shaping @text, copied with hb_buffer_append(),
+ * with @font, @features and @shaper_list, and neither @text nor @buffer
+ * may be changed otherwise in between calls.
+ *
+ * Text that cannot be reshaped in part, such as with ranged features,
+ * a message function, a cluster level other than the monotone ones, or
+ * the #HB_BUFFER_FLAG_VERIFY or #HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT
+ * flags, is shaped as a whole by hb_shape_full().
+ *
+ * Return value: false if the edit is out of range, @inserted_length is
+ * negative but for -1, or all shapers failed, true otherwise
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_shape_edit (hb_font_t          *font,
+	       hb_buffer_t        *buffer,
+	       hb_buffer_t        *text,
+	       unsigned int        offset,
+	       unsigned int        removed_length,
+	       const uint32_t     *inserted,
+	       int                 inserted_length,
+	       const hb_feature_t *features,
+	       unsigned int        num_features,
+	       const char * const *shaper_list)
+{
+  if (unlikely (hb_object_is_immutable (buffer) || hb_object_is_immutable (text)))
+    return false;
+  if (unlikely (offset > text->len || removed_length > text->len - offset))
+    return false;
+  if (inserted_length == -1)
+    inserted_length = hb_utf32_t::strlen (inserted);
+  if (unlikely (inserted_length < 0))
+    return false;
+
+  unsigned int old_len = text->len;
+  bool incremental = _hb_shape_edit_is_incremental (buffer, text, features, num_features);
+  if (unlikely (!_hb_shape_edit_text (text, offset, removed_length, inserted, inserted_length)))
+    return false;
+
+  if (incremental)
+  {
+    hb_shape_plan_t *shape_plan = hb_shape_plan_create_cached2 (font->face, &text->props,
+								features, num_features,
+								font->coords, font->num_coords,
+								shaper_list);
+
+    bool ret = false;
+    if (_hb_shape_split_plan_reports_concat (shape_plan))
+    {
+      hb_shape_edit_context_t c (font, buffer, text, features, num_features, shape_plan, old_len);
+      ret = c.shape (offset, removed_length);
+    }
+
+    hb_shape_plan_destroy (shape_plan);
+
+    if (ret)
+      return true;
+  }
+
+  /* Shape the whole text. */
+  hb_buffer_clear_contents (buffer);
+  hb_buffer_set_unicode_funcs (buffer, text->unicode);
+  hb_buffer_set_flags (buffer, text->flags);
+  hb_buffer_set_cluster_level (buffer, text->cluster_level);
+  hb_buffer_set_replacement_codepoint (buffer, text->replacement);
+  hb_buffer_set_invisible_glyph (buffer, text->invisible);
+  hb_buffer_set_not_found_glyph (buffer, text->not_found);
+  hb_buffer_append (buffer, text, 0, text->len);
+  return hb_shape_full (font, buffer, features, num_features, shaper_list);
+}
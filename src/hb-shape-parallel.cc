@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb.hh"
+#include "hb-shape-split.hh"
+
+
+/* Pieces are at least this many characters long, ending at the next
+ * word start. */
+#ifndef HB_SHAPE_PARALLEL_PIECE_LENGTH
+#define HB_SHAPE_PARALLEL_PIECE_LENGTH 1024
+#endif
+
+
+/*
+ * hb_shape_parallel_context_t
+ *
+ * State for shaping one buffer in pieces.
+ *
+ * Each piece is shaped as an hb_shape_split_run_t.  Where the pieces
+ * on both sides of a seam say it is safe to break, the glyphs of each
+ * piece's own text are concatenated.
+ */
+
+struct hb_shape_parallel_context_t
+{
+  typedef hb_shape_split_run_t piece_t;
+
+  hb_font_t *font;
+  hb_buffer_t *buffer;
+  const hb_feature_t *features;
+  unsigned int num_features;
+  hb_shape_plan_t *shape_plan;
+
+  hb_vector_t<piece_t> pieces;
+  hb_vector_t<unsigned int> todo; /* Pieces to shape. */
+
+  hb_shape_parallel_context_t (hb_font_t          *font_,
+			       hb_buffer_t        *buffer_,
+			       const hb_feature_t *features_,
+			       unsigned int        num_features_,
+			       hb_shape_plan_t    *shape_plan_) :
+			       font (font_),
+			       buffer (buffer_),
+			       features (features_),
+			       num_features (num_features_),
+			       shape_plan (shape_plan_) {}
+  ~hb_shape_parallel_context_t ()
+  {
+    for (unsigned int i = 0; i < pieces.length; i++)
+      pieces[i].fini ();
+  }
+
+  bool is_word_start (unsigned int i) const
+  { return hb_shape_split_run_t::is_word_start (buffer, i); }
+
+  /* Splits the text at word starts.  Returns false if it does not
+   * split into more than one piece. */
+  bool split ()
+  {
+    unsigned int count = buffer->len;
+    unsigned int start = 0;
+    for (unsigned int end = HB_SHAPE_PARALLEL_PIECE_LENGTH; end < count; end++)
+    {
+      if (!is_word_start (end))
+	continue;
+
+      pieces.push (piece_t {start, end});
+      start = end;
+      end += HB_SHAPE_PARALLEL_PIECE_LENGTH - 1;
+    }
+    if (!start)
+      return false;
+    pieces.push (piece_t {start, count});
+
+    return !pieces.in_error ();
+  }
+
+  static void shape_task (unsigned int index, void *task_data)
+  {
+    hb_shape_parallel_context_t *c = (hb_shape_parallel_context_t *) task_data;
+    c->pieces[c->todo[index]].shape (c->shape_plan, c->font, c->buffer,
+					 c->features, c->num_features);
+  }
+
+  bool shape (hb_shape_executor_func_t executor, void *user_data)
+  {
+    for (unsigned int i = 0; i < pieces.length; i++)
+      todo.push (i);
+
+    do
+    {
+      if (unlikely (todo.in_error ()))
+	return false;
+
+      if (executor)
+	executor (todo.length, shape_task, this, user_data);
+      else
+	for (unsigned int i = 0; i < todo.length; i++)
+	  shape_task (i, this);
+
+      for (unsigned int i : todo)
+	if (unlikely (!pieces[i].success))
+	  return false;
+
+      merge_unsafe ();
+    }
+    while (todo.length);
+
+    return assemble ();
+  }
+
+  /* Where either side of a seam is unsafe to break, joins the pieces
+   * around it, to be shaped again together.  Runs of unsafe seams are
+   * joined at once, so that text with no safe seams at all is shaped
+   * only twice. */
+  void merge_unsafe ()
+  {
+    todo.resize (0);
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < pieces.length; i++)
+    {
+      piece_t piece = pieces[i];
+      pieces[i].buffer = nullptr;
+
+      if (j && (pieces[j - 1].tail_unsafe || piece.head_unsafe))
+      {
+	piece_t &prev = pieces[j - 1];
+	hb_buffer_destroy (prev.buffer);
+	hb_buffer_destroy (piece.buffer);
+	prev.buffer = nullptr;
+	prev.end = piece.end;
+	prev.tail_unsafe = piece.tail_unsafe;
+	if (!todo.length || todo.tail () != j - 1)
+	  todo.push (j - 1);
+	continue;
+      }
+
+      pieces[j++] = piece;
+    }
+    pieces.shrink (j);
+  }
+
+  bool assemble ()
+  {
+    /* Appending glyphs clears the post-context; keep it as shaping
+     * the buffer as a whole would. */
+    hb_codepoint_t context[2][hb_buffer_t::CONTEXT_LENGTH];
+    unsigned int context_len[2];
+    hb_memcpy (context, buffer->context, sizeof (context));
+    hb_memcpy (context_len, buffer->context_len, sizeof (context_len));
+
+    unsigned int count = 0;
+    for (const piece_t &piece : pieces)
+      count += piece.glyph_end - piece.glyph_start;
+    if (unlikely (!buffer->ensure (count)))
+      return false;
+
+    /* Appending cannot fail anymore. */
+    bool forward = HB_DIRECTION_IS_FORWARD (buffer->props.direction);
+    buffer->len = 0;
+    for (unsigned int p = 0; p < pieces.length; p++)
+    {
+      const piece_t &piece = pieces[forward ? p : pieces.length - 1 - p];
+      hb_buffer_append (buffer, piece.buffer, piece.glyph_start, piece.glyph_end);
+    }
+
+    hb_memcpy (buffer->context, context, sizeof (context));
+    hb_memcpy (buffer->context_len, context_len, sizeof (context_len));
+    buffer->shaping_failed = false;
+
+    return true;
+  }
+};
+
+
+/**
+ * hb_shape_parallel:
+ * @font: an #hb_font_t to use for shaping
+ * @buffer: an #hb_buffer_t to shape
+ * @features: (array length=num_features) (nullable): an array of user
+ *    specified #hb_feature_t or %NULL
+ * @num_features: the length of @features array
+ * @shaper_list: (array zero-terminated=1) (nullable): a %NULL-terminated
+ *    array of shapers to use or %NULL
+ * @executor: (nullable): a callback to run the shaping tasks, or %NULL
+ *    to run them one after the other
+ * @user_data: User data to pass to @executor
+ *
+ * Shapes @buffer like hb_shape_full() does, splitting long text into
+ * pieces at word boundaries and shaping the pieces concurrently, using
+ * @executor.  Pieces are shaped along with a little of the text around
+ * them, and only joined where the shaper reports the seam safe to
+ * break on both sides; around the other seams the text is shaped
+ * again, as a whole.  The output is the same as that of hb_shape_full().
+ *
+ * The pieces are all shaped with @font, from any thread that @executor
+ * runs them on; @font must not be modified meanwhile.  See
+ * hb_font_freeze().
+ *
+ * Buffers that do not split well, such as short ones, ones with ranged
+ * features, non-increasing cluster values, a message function, or the
+ * #HB_BUFFER_FLAG_VERIFY or #HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT
+ * flags, are shaped by hb_shape_full() on the calling thread.
+ *
+ * Return value: false if all shapers failed, true otherwise
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_shape_parallel (hb_font_t                *font,
+		   hb_buffer_t              *buffer,
+		   const hb_feature_t       *features,
+		   unsigned int              num_features,
+		   const char * const       *shaper_list,
+		   hb_shape_executor_func_t  executor,
+		   void                     *user_data)
+{
+  /* Lookups running into the end of a piece can mark glyphs unsafe to
+   * concat that would not be when shaping the whole text. */
+  if (buffer->len <= HB_SHAPE_PARALLEL_PIECE_LENGTH ||
+      (buffer->flags & HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT) ||
+      buffer->messaging () ||
+      !_hb_shape_split_buffer_is_splittable (buffer, features, num_features))
+    return hb_shape_full (font, buffer, features, num_features, shaper_list);
+
+  hb_shape_plan_t *shape_plan = hb_shape_plan_create_cached2 (font->face, &buffer->props,
+							      features, num_features,
+							      font->coords, font->num_coords,
+							      shaper_list);
+
+  bool ret = false;
+  if (_hb_shape_split_plan_reports_concat (shape_plan))
+  {
+    hb_shape_parallel_context_t c (font, buffer, features, num_features, shape_plan);
+    ret = c.split () && c.shape (executor, user_data);
+  }
+
+  hb_shape_plan_destroy (shape_plan);
+
+  /* Fall back to shaping the whole buffer. */
+  if (!ret)
+    return hb_shape_full (font, buffer, features, num_features, shaper_list);
+
+  return true;
+}
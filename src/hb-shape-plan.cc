@@ -29,6 +29,7 @@
 #include "hb-shaper.hh"
 #include "hb-font.hh"
 #include "hb-buffer.hh"
+#include "hb-ot-layout-snapshot.hh"
 
 
 /**
@@ -135,7 +136,7 @@ bail:
 }
 
 bool
-hb_shape_plan_key_t::user_features_match (const hb_shape_plan_key_t *other)
+hb_shape_plan_key_t::user_features_match (const hb_shape_plan_key_t *other) const
 {
   if (this->num_user_features != other->num_user_features)
     return false;
@@ -153,7 +154,7 @@ hb_shape_plan_key_t::user_features_match (const hb_shape_plan_key_t *other)
 }
 
 bool
-hb_shape_plan_key_t::equal (const hb_shape_plan_key_t *other)
+hb_shape_plan_key_t::equal (const hb_shape_plan_key_t *other) const
 {
   return hb_segment_properties_equal (&this->props, &other->props) &&
 	 this->user_features_match (other) &&
@@ -163,6 +164,321 @@ hb_shape_plan_key_t::equal (const hb_shape_plan_key_t *other)
 	 this->shaper_func == other->shaper_func;
 }
 
+uint32_t
+hb_shape_plan_key_t::hash () const
+{
+  /* Must agree with equal(): only global-ness of feature ranges matters. */
+  uint32_t h = hb_segment_properties_hash (&this->props);
+  h = h * 31 + num_user_features;
+  for (unsigned int i = 0; i < num_user_features; i++)
+  {
+    h = h * 31 + user_features[i].tag;
+    h = h * 31 + user_features[i].value;
+    h = h * 31 + (user_features[i].start == HB_FEATURE_GLOBAL_START &&
+		  user_features[i].end   == HB_FEATURE_GLOBAL_END);
+  }
+#ifndef HB_NO_OT_SHAPE
+  h = h * 31 + this->ot.hash ();
+#endif
+  h = h * 31 + hb_hash ((uintptr_t) this->shaper_func);
+  return h;
+}
+
+
+/*
+ * hb_shape_plan_cache_t
+ */
+
+#ifndef HB_NO_OT_SHAPE
+/* Plans derive from plans of the same properties and variations; see
+ * hb_shape_plan_cache_t::find_base(). */
+static bool
+_hb_shape_plan_key_same_base (const hb_shape_plan_key_t *key,
+			      const hb_shape_plan_key_t *other)
+{
+  return other->shaper_func == key->shaper_func &&
+	 other->ot.equal (&key->ot) &&
+	 hb_segment_properties_equal (&other->props, &key->props);
+}
+
+static uint32_t
+_hb_shape_plan_key_base_hash (const hb_shape_plan_key_t *key)
+{
+  uint32_t h = hb_segment_properties_hash (&key->props);
+  h = h * 31 + key->ot.hash ();
+  h = h * 31 + hb_hash ((uintptr_t) key->shaper_func);
+  return h;
+}
+#endif
+
+bool
+hb_shape_plan_cache_t::snapshot_t::index ()
+{
+  unsigned int size = 8;
+  while (size < 2 * entries.length)
+    size <<= 1;
+  if (unlikely (!buckets.resize (size) ||
+		!base_buckets.resize (size)))
+    return false;
+
+  unsigned int mask = size - 1;
+  for (unsigned int i = 0; i < entries.length; i++)
+  {
+    const hb_shape_plan_key_t *key = &entries.arrayZ[i].shape_plan->key;
+
+    unsigned int b = entries.arrayZ[i].hash & mask;
+    while (buckets.arrayZ[b])
+      b = (b + 1) & mask;
+    buckets.arrayZ[b] = i + 1;
+
+#ifndef HB_NO_OT_SHAPE
+    /* Keep the first plan with the fewest user features. */
+    if (key->shaper_func != _hb_ot_shape)
+      continue;
+    for (b = _hb_shape_plan_key_base_hash (key) & mask; base_buckets.arrayZ[b]; b = (b + 1) & mask)
+    {
+      const hb_shape_plan_key_t *base = &entries.arrayZ[base_buckets.arrayZ[b] - 1].shape_plan->key;
+      if (_hb_shape_plan_key_same_base (key, base))
+      {
+	if (key->num_user_features < base->num_user_features)
+	  base_buckets.arrayZ[b] = i + 1;
+	break;
+      }
+    }
+    if (!base_buckets.arrayZ[b])
+      base_buckets.arrayZ[b] = i + 1;
+#endif
+  }
+  return true;
+}
+
+const hb_shape_plan_cache_t::entry_t *
+hb_shape_plan_cache_t::snapshot_t::find (const hb_shape_plan_key_t *key,
+					 uint32_t hash) const
+{
+  unsigned int mask = buckets.length - 1;
+  for (unsigned int b = hash & mask; buckets.arrayZ[b]; b = (b + 1) & mask)
+  {
+    const entry_t *entry = &entries.arrayZ[buckets.arrayZ[b] - 1];
+    if (entry->hash == hash && entry->shape_plan->key.equal (key))
+      return entry;
+  }
+  return nullptr;
+}
+
+hb_shape_plan_t *
+hb_shape_plan_cache_t::snapshot_t::find_base (const hb_shape_plan_key_t *key HB_UNUSED) const
+{
+#ifndef HB_NO_OT_SHAPE
+  unsigned int mask = base_buckets.length - 1;
+  for (unsigned int b = _hb_shape_plan_key_base_hash (key) & mask; base_buckets.arrayZ[b]; b = (b + 1) & mask)
+  {
+    hb_shape_plan_t *base = entries.arrayZ[base_buckets.arrayZ[b] - 1].shape_plan;
+    if (_hb_shape_plan_key_same_base (key, &base->key))
+      return base;
+  }
+#endif
+  return nullptr;
+}
+
+hb_shape_plan_t *
+hb_shape_plan_cache_t::lookup (const hb_shape_plan_key_t *key)
+{
+  uint32_t hash = key->hash ();
+  hb_shape_plan_t *shape_plan = nullptr;
+
+  const snapshot_t *current = enter ();
+  const entry_t *entry = current ? current->find (key, hash) : nullptr;
+  if (entry)
+  {
+    /* The CLOCK bits are only hints; don't write them needlessly. */
+    if (!entry->referenced.get_relaxed ())
+      entry->referenced.set_relaxed (true);
+    shape_plan = hb_shape_plan_reference (entry->shape_plan);
+  }
+  leave ();
+
+  if (shape_plan)
+    hits.inc ();
+  else
+    misses.inc ();
+  return shape_plan;
+}
+
+hb_shape_plan_t *
+hb_shape_plan_cache_t::insert (hb_shape_plan_t *shape_plan)
+{
+  if (unlikely (!hb_object_is_valid (shape_plan)))
+    return shape_plan;
+
+  uint32_t hash = shape_plan->key.hash ();
+
+  hb_lock_t l (lock);
+
+  /* Another thread might have beaten us to it. */
+  snapshot_t *current = snapshot.get_relaxed ();
+  const entry_t *entry = current ? current->find (&shape_plan->key, hash) : nullptr;
+  if (entry)
+  {
+    hb_shape_plan_destroy (shape_plan);
+    entry->referenced.set_relaxed (true);
+    return hb_shape_plan_reference (entry->shape_plan);
+  }
+
+  if (unlikely (!capacity))
+    return shape_plan;
+
+  unsigned int length = current ? current->entries.length : 0;
+  hb_array_t<const entry_t> evicted;
+  unsigned int i;
+  if (length < capacity)
+    i = length++;
+  else
+  {
+    /* CLOCK: Give recently used plans a second chance. */
+    while (current->entries.arrayZ[hand].referenced.get_relaxed ())
+    {
+      current->entries.arrayZ[hand].referenced.set_relaxed (false);
+      hand = (hand + 1) % length;
+    }
+    i = hand;
+    hand = (hand + 1) % length;
+    evicted = current->entries.as_array ().sub_array (i, 1);
+  }
+
+  snapshot_t *next = create_snapshot (current, length);
+  if (unlikely (!next))
+    return shape_plan;
+  next->entries.arrayZ[i].shape_plan = shape_plan;
+  next->entries.arrayZ[i].hash = hash;
+  next->entries.arrayZ[i].referenced.set_relaxed (false);
+  if (unlikely (!next->index () || !publish (next, evicted)))
+  {
+    destroy_snapshot (next);
+    return shape_plan;
+  }
+
+  return hb_shape_plan_reference (shape_plan);
+}
+
+/* Any OpenType plan of the same properties and variations will do; the
+ * one with the fewest user features is most likely to differ from key
+ * only in feature ranges or values. */
+hb_shape_plan_t *
+hb_shape_plan_cache_t::find_base (const hb_shape_plan_key_t *key)
+{
+#ifndef HB_NO_OT_SHAPE
+  if (key->shaper_func != _hb_ot_shape)
+    return nullptr;
+
+  const snapshot_t *current = enter ();
+  hb_shape_plan_t *base = current ? hb_shape_plan_reference (current->find_base (key)) : nullptr;
+  leave ();
+  return base;
+#else
+  return nullptr;
+#endif
+}
+
+void
+hb_shape_plan_cache_t::set_capacity (unsigned int new_capacity)
+{
+  hb_lock_t l (lock);
+
+  capacity = new_capacity;
+  snapshot_t *current = snapshot.get_relaxed ();
+  if (current && current->entries.length > capacity)
+  {
+    snapshot_t *next = nullptr;
+    if (capacity &&
+	unlikely (!(next = create_snapshot (current, capacity)) || !next->index ()))
+    {
+      /* Leave the plans in; insert() evicts them in turn. */
+      if (next)
+	destroy_snapshot (next);
+      return;
+    }
+    if (unlikely (!publish (next, current->entries.as_array ().sub_array (capacity))))
+    {
+      if (next)
+	destroy_snapshot (next);
+      return;
+    }
+  }
+  if (hand >= capacity)
+    hand = 0;
+}
+
+/* Copies the first length entries of current, or as many as it has, into
+ * a new snapshot of length entries. */
+hb_shape_plan_cache_t::snapshot_t *
+hb_shape_plan_cache_t::create_snapshot (const snapshot_t *current,
+					unsigned int length)
+{
+  snapshot_t *next = (snapshot_t *) hb_calloc (1, sizeof (snapshot_t));
+  if (unlikely (!next))
+    return nullptr;
+  next->init ();
+  if (unlikely (!next->entries.resize (length)))
+  {
+    destroy_snapshot (next);
+    return nullptr;
+  }
+
+  unsigned int count = current ? hb_min (current->entries.length, length) : 0;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    const entry_t &entry = current->entries.arrayZ[i];
+    next->entries.arrayZ[i].shape_plan = entry.shape_plan;
+    next->entries.arrayZ[i].hash = entry.hash;
+    next->entries.arrayZ[i].referenced.set_relaxed (entry.referenced.get_relaxed ());
+  }
+  return next;
+}
+
+/* Replaces the snapshot with next.  The old snapshot, and the evicted
+ * plans, are freed once no lookup can be reading them. */
+bool
+hb_shape_plan_cache_t::publish (snapshot_t *next,
+				hb_array_t<const entry_t> evicted)
+{
+  snapshot_t *current = snapshot.get_relaxed ();
+  if (unlikely (!retired_snapshots.alloc (retired_snapshots.length + 1) ||
+		!retired_plans.alloc (retired_plans.length + evicted.length)))
+    return false;
+
+  while (!snapshot.cmpexch (current, next))
+    ;
+  if (current)
+    retired_snapshots.push (current);
+  for (const entry_t &entry : evicted)
+  {
+    DEBUG_MSG_FUNC (SHAPE_PLAN, entry.shape_plan, "evicted from cache");
+    retired_plans.push (entry.shape_plan);
+    evictions++;
+  }
+
+  /* Either we see the lookups still running, or the last of them sees
+   * has_retired. */
+  has_retired.set_relaxed (1);
+  _hb_memory_barrier ();
+  if (!readers.get ())
+    reclaim ();
+  return true;
+}
+
+void
+hb_shape_plan_cache_t::reclaim ()
+{
+  for (snapshot_t *old : retired_snapshots)
+    destroy_snapshot (old);
+  retired_snapshots.resize (0);
+  for (hb_shape_plan_t *shape_plan : retired_plans)
+    hb_shape_plan_destroy (shape_plan);
+  retired_plans.resize (0);
+  has_retired.set_relaxed (0);
+}
+
 
 /*
  * hb_shape_plan_t
@@ -256,8 +572,28 @@ hb_shape_plan_create2 (hb_face_t                     *face,
 				       shaper_list)))
     goto bail2;
 #ifndef HB_NO_OT_SHAPE
-  if (unlikely (!shape_plan->ot.init0 (face, &shape_plan->key)))
-    goto bail3;
+  {
+    /* Derive from a cached plan, or else a snapshot, if possible. */
+    hb_shape_plan_t *base = nullptr;
+    const hb_ot_map_t *base_map = nullptr;
+    const hb_ot_layout_snapshot_t *snapshot = nullptr;
+    hb_ot_map_t snapshot_map;
+    snapshot_map.init ();
+    if (hb_object_is_valid (face))
+    {
+      base = face->shape_plans.find_base (&shape_plan->key);
+      if (base)
+	base_map = &base->ot.map;
+      else if ((snapshot = hb_ot_layout_snapshot_t::get_for_face (face)) &&
+	       snapshot->get_map (face, &shape_plan->key, &snapshot_map))
+	base_map = &snapshot_map;
+    }
+    bool ret = shape_plan->ot.init0 (face, &shape_plan->key, base_map);
+    snapshot_map.fini ();
+    hb_shape_plan_destroy (base);
+    if (unlikely (!ret))
+      goto bail3;
+  }
 #endif
 
   return shape_plan;
@@ -527,9 +863,6 @@ hb_shape_plan_create_cached2 (hb_face_t                     *face,
 		  num_user_features,
 		  shaper_list);
 
-retry:
-  hb_face_t::plan_node_t *cached_plan_nodes = face->shape_plans;
-
   bool dont_cache = !hb_object_is_valid (face);
 
   if (likely (!dont_cache))
@@ -545,12 +878,12 @@ retry:
 		   shaper_list))
       return hb_shape_plan_get_empty ();
 
-    for (hb_face_t::plan_node_t *node = cached_plan_nodes; node; node = node->next)
-      if (node->shape_plan->key.equal (&key))
-      {
-	DEBUG_MSG_FUNC (SHAPE_PLAN, node->shape_plan, "fulfilled from cache");
-	return hb_shape_plan_reference (node->shape_plan);
-      }
+    hb_shape_plan_t *shape_plan = face->shape_plans.lookup (&key);
+    if (shape_plan)
+    {
+      DEBUG_MSG_FUNC (SHAPE_PLAN, shape_plan, "fulfilled from cache");
+      return shape_plan;
+    }
   }
 
   hb_shape_plan_t *shape_plan = hb_shape_plan_create2 (face, props,
@@ -561,20 +894,8 @@ retry:
   if (unlikely (dont_cache))
     return shape_plan;
 
-  hb_face_t::plan_node_t *node = (hb_face_t::plan_node_t *) hb_calloc (1, sizeof (hb_face_t::plan_node_t));
-  if (unlikely (!node))
-    return shape_plan;
-
-  node->shape_plan = shape_plan;
-  node->next = cached_plan_nodes;
-
-  if (unlikely (!face->shape_plans.cmpexch (cached_plan_nodes, node)))
-  {
-    hb_shape_plan_destroy (shape_plan);
-    hb_free (node);
-    goto retry;
-  }
+  shape_plan = face->shape_plans.insert (shape_plan);
   DEBUG_MSG_FUNC (SHAPE_PLAN, shape_plan, "inserted into cache");
 
-  return hb_shape_plan_reference (shape_plan);
+  return shape_plan;
 }
@@ -30,6 +30,13 @@
 #include "hb.hh"
 #include "hb-shaper.hh"
 #include "hb-ot-shape.hh"
+#include "hb-map.hh"
+#include "hb-mutex.hh"
+
+
+#ifndef HB_SHAPE_PLAN_CACHE_SIZE
+#define HB_SHAPE_PLAN_CACHE_SIZE 256
+#endif
 
 
 struct hb_shape_plan_key_t
@@ -57,9 +64,12 @@ struct hb_shape_plan_key_t
 
   HB_INTERNAL void fini () { hb_free ((void *) user_features); }
 
-  HB_INTERNAL bool user_features_match (const hb_shape_plan_key_t *other);
+  HB_INTERNAL bool user_features_match (const hb_shape_plan_key_t *other) const;
+
+  HB_INTERNAL bool equal (const hb_shape_plan_key_t *other) const;
+  bool operator == (const hb_shape_plan_key_t &other) const { return equal (&other); }
 
-  HB_INTERNAL bool equal (const hb_shape_plan_key_t *other);
+  HB_INTERNAL uint32_t hash () const;
 };
 
 struct hb_shape_plan_t
@@ -73,4 +83,155 @@ struct hb_shape_plan_t
 };
 
 
+/*
+ * hb_shape_plan_cache_t
+ *
+ * Per-face, size-bounded cache of shape plans.  Plans are found by
+ * hashing their key, and evicted using the CLOCK (second-chance)
+ * algorithm once the cache is full.
+ *
+ * Lookups take no lock: they read the current snapshot of the cache, and
+ * only set the CLOCK bits of the plans they find.  Insertions and
+ * evictions are serialized by the lock; they publish a new snapshot, and
+ * keep the old one and the evicted plans until no lookup is running.
+ * Those are freed by the next insertion that sees no lookup running, or
+ * else by the last lookup to leave.
+ */
+
+struct hb_shape_plan_cache_t
+{
+  struct entry_t
+  {
+    hb_shape_plan_t *shape_plan;
+    uint32_t hash;
+    mutable hb_atomic_int_t referenced;
+  };
+
+  /* Immutable once published, but for the referenced bits. */
+  struct snapshot_t
+  {
+    void init ()
+    {
+      entries.init ();
+      buckets.init ();
+      base_buckets.init ();
+    }
+    void fini ()
+    {
+      entries.fini ();
+      buckets.fini ();
+      base_buckets.fini ();
+    }
+
+    /* Fills in the buckets, once the entries are. */
+    HB_INTERNAL bool index ();
+
+    HB_INTERNAL const entry_t *find (const hb_shape_plan_key_t *key, uint32_t hash) const;
+    HB_INTERNAL hb_shape_plan_t *find_base (const hb_shape_plan_key_t *key) const;
+
+    hb_vector_t<entry_t> entries; /* In CLOCK order. */
+    hb_vector_t<unsigned int> buckets; /* One plus index into entries, by key hash. */
+    hb_vector_t<unsigned int> base_buckets; /* Likewise, of the plan find_base() returns
+					     * for the properties and variations. */
+  };
+
+  void init ()
+  {
+    lock.init ();
+    snapshot.init ();
+    retired_snapshots.init ();
+    retired_plans.init ();
+    readers.set_relaxed (0);
+    has_retired.set_relaxed (0);
+    capacity = HB_SHAPE_PLAN_CACHE_SIZE;
+    hand = 0;
+    hits.set_relaxed (0);
+    misses.set_relaxed (0);
+    evictions = 0;
+  }
+  void fini ()
+  {
+    snapshot_t *current = snapshot.get_relaxed ();
+    if (current)
+    {
+      for (const entry_t &entry : current->entries)
+	hb_shape_plan_destroy (entry.shape_plan);
+      destroy_snapshot (current);
+    }
+    reclaim ();
+    retired_snapshots.fini ();
+    retired_plans.fini ();
+    lock.fini ();
+  }
+
+  /* Returns a new reference to the matching plan, or nullptr. */
+  HB_INTERNAL hb_shape_plan_t *lookup (const hb_shape_plan_key_t *key);
+  /* Takes ownership of shape_plan; returns the plan to use. */
+  HB_INTERNAL hb_shape_plan_t *insert (hb_shape_plan_t *shape_plan);
+  /* Returns a new reference to a plan that a plan for key can be
+   * derived from, or nullptr. */
+  HB_INTERNAL hb_shape_plan_t *find_base (const hb_shape_plan_key_t *key);
+
+  HB_INTERNAL void set_capacity (unsigned int new_capacity);
+  unsigned int get_capacity () { hb_lock_t l (lock); return capacity; }
+
+  void get_stats (unsigned int *hits_out,
+		  unsigned int *misses_out,
+		  unsigned int *evictions_out)
+  {
+    hb_lock_t l (lock);
+    if (hits_out) *hits_out = hits.get_relaxed ();
+    if (misses_out) *misses_out = misses.get_relaxed ();
+    if (evictions_out) *evictions_out = evictions;
+  }
+
+  private:
+  /* Lookups read the snapshot between enter() and leave(). */
+  const snapshot_t *enter ()
+  {
+    readers.inc ();
+    _hb_memory_barrier ();
+    return snapshot.get ();
+  }
+  void leave ()
+  {
+    if (readers.dec () != 1)
+      return;
+
+    /* The last lookup out frees what publish() could not.  If the lock
+     * is busy, a later lookup or insertion will. */
+    _hb_memory_barrier ();
+    if (has_retired.get_relaxed () && lock.try_lock ())
+    {
+      if (!readers.get ())
+	reclaim ();
+      lock.unlock ();
+    }
+  }
+
+  static snapshot_t *create_snapshot (const snapshot_t *current, unsigned int length);
+  static void destroy_snapshot (snapshot_t *old)
+  {
+    old->fini ();
+    hb_free (old);
+  }
+
+  /* These are called with the lock held. */
+  bool publish (snapshot_t *next, hb_array_t<const entry_t> evicted);
+  void reclaim ();
+
+  hb_mutex_t lock;
+  hb_atomic_ptr_t<snapshot_t> snapshot;
+  hb_vector_t<snapshot_t *> retired_snapshots; /* Kept while lookups might read them. */
+  hb_vector_t<hb_shape_plan_t *> retired_plans; /* Likewise. */
+  hb_atomic_int_t readers; /* Number of lookups in progress. */
+  hb_atomic_int_t has_retired; /* Whether the above lists are non-empty. */
+  unsigned int capacity;
+  unsigned int hand;
+  hb_atomic_int_t hits;
+  hb_atomic_int_t misses;
+  unsigned int evictions;
+};
+
+
 #endif /* HB_SHAPE_PLAN_HH */
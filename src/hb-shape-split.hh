@@ -0,0 +1,310 @@
+/*
+ * Copyright © 2026  Behdad Esfahbod
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#ifndef HB_SHAPE_SPLIT_HH
+#define HB_SHAPE_SPLIT_HH
+
+#include "hb.hh"
+#include "hb-shape-plan.hh"
+#include "hb-font.hh"
+#include "hb-buffer.hh"
+#include "hb-ot-layout-gsub-table.hh"
+#include "hb-ot-layout-gpos-table.hh"
+
+
+/*
+ * Splitting text into separately shaped pieces.
+ *
+ * Text is split after spaces, and the pieces shaped on their own are
+ * only concatenated where HB_GLYPH_FLAG_UNSAFE_TO_CONCAT allows it.
+ * Used by hb_shape_cached(), hb_shape_parallel() and hb_shape_edit().
+ */
+
+
+/* Whether the buffer can be split at all.  Ranged features and shared
+ * clusters tie pieces together. */
+static inline bool
+_hb_shape_split_buffer_is_splittable (hb_buffer_t        *buffer,
+				      const hb_feature_t *features,
+				      unsigned int        num_features)
+{
+  if (buffer->content_type != HB_BUFFER_CONTENT_TYPE_UNICODE ||
+      !HB_DIRECTION_IS_VALID (buffer->props.direction) ||
+      (buffer->flags & HB_BUFFER_FLAG_VERIFY))
+    return false;
+
+  for (unsigned int i = 0; i < num_features; i++)
+    if (features[i].start != HB_FEATURE_GLOBAL_START ||
+	features[i].end != HB_FEATURE_GLOBAL_END)
+      return false;
+  for (unsigned int i = 1; i < buffer->len; i++)
+    if (buffer->info[i].cluster <= buffer->info[i - 1].cluster)
+      return false;
+
+  return true;
+}
+
+/* Whether the plan reliably reports unsafe-to-concat positions.
+ * Only the OpenType shaper does; AAT tables do not. */
+static inline bool
+_hb_shape_split_plan_reports_concat (hb_shape_plan_t *shape_plan)
+{
+#ifndef HB_NO_OT_SHAPE
+  return shape_plan->key.shaper_func == _hb_ot_shape &&
+	 !shape_plan->ot.apply_morx &&
+	 !shape_plan->ot.apply_kerx &&
+	 !shape_plan->ot.apply_trak;
+#else
+  return false;
+#endif
+}
+
+#ifndef HB_NO_OT_SHAPE
+template <typename Accelerator>
+static inline bool
+_hb_shape_split_lookups_cover (const Accelerator &accel,
+			       hb_array_t<const hb_ot_map_t::lookup_map_t> lookups,
+			       hb_codepoint_t glyph)
+{
+  for (const hb_ot_map_t::lookup_map_t &lookup : lookups)
+    if (lookup.index >= accel.lookup_count ||
+	accel.accels[lookup.index].covers (glyph))
+      return true;
+  return false;
+}
+#endif
+
+/* Words can only be shaped apart if the space glyph separating them
+ * takes no part in layout.  A lookup reaching over the space from
+ * either side runs off the end of the word, which the unsafe-to-concat
+ * flags catch; but one starting at the space itself leaves no trace. */
+static inline bool
+_hb_shape_split_space_is_inert (hb_shape_plan_t *shape_plan,
+				hb_font_t       *font)
+{
+#ifndef HB_NO_OT_SHAPE
+  const hb_ot_shape_plan_t &plan = shape_plan->ot;
+  if (plan.apply_kern)
+    return false;
+#ifndef HB_DISABLE_DEPRECATED
+  if (plan.apply_fallback_kern &&
+      (font->has_glyph_h_kerning_func () || font->has_glyph_v_kerning_func ()))
+    return false;
+#endif
+
+  hb_codepoint_t space;
+  if (!font->get_nominal_glyph (' ', &space))
+    return false;
+
+  return !_hb_shape_split_lookups_cover (*font->face->table.GSUB, plan.map.get_lookups (0), space) &&
+	 !_hb_shape_split_lookups_cover (*font->face->table.GPOS, plan.map.get_lookups (1), space);
+#else
+  return false;
+#endif
+}
+
+/* Whether a word starts at u, following prev.  Marks and format
+ * characters can attach to whatever precedes them, even across a
+ * space. */
+static inline bool
+_hb_shape_split_is_word_start (hb_unicode_funcs_t *unicode,
+			       hb_codepoint_t      prev,
+			       hb_codepoint_t      u)
+{
+  if (prev != ' ' || u == ' ')
+    return false;
+  switch ((unsigned) unicode->general_category (u))
+  {
+    case HB_UNICODE_GENERAL_CATEGORY_FORMAT:
+    case HB_UNICODE_GENERAL_CATEGORY_SPACING_MARK:
+    case HB_UNICODE_GENERAL_CATEGORY_ENCLOSING_MARK:
+    case HB_UNICODE_GENERAL_CATEGORY_NON_SPACING_MARK:
+      return false;
+    default:
+      return true;
+  }
+}
+
+/* Finds whether the first and last clusters of a shaped piece are
+ * sensitive to the text around it. */
+static inline void
+_hb_shape_split_get_edges (hb_array_t<const hb_glyph_info_t> glyphs,
+			   bool *head_unsafe,
+			   bool *tail_unsafe)
+{
+  if (unlikely (!glyphs.length))
+  {
+    *head_unsafe = *tail_unsafe = true;
+    return;
+  }
+  unsigned int first = (unsigned int) -1, last = 0;
+  for (const hb_glyph_info_t &g : glyphs)
+  {
+    first = hb_min (first, g.cluster);
+    last = hb_max (last, g.cluster);
+  }
+  *head_unsafe = *tail_unsafe = false;
+  for (const hb_glyph_info_t &g : glyphs)
+    if (g.mask & HB_GLYPH_FLAG_UNSAFE_TO_CONCAT)
+    {
+      if (g.cluster == first) *head_unsafe = true;
+      if (g.cluster == last) *tail_unsafe = true;
+    }
+}
+
+/* Pieces are shaped with HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT; drop
+ * the flags the caller did not ask for. */
+static inline void
+_hb_shape_split_fixup_flags (hb_buffer_flags_t flags,
+			     hb_glyph_info_t  &info)
+{
+  if (!(flags & HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT) &&
+      !(info.mask & HB_GLYPH_FLAG_UNSAFE_TO_BREAK))
+    info.mask &= ~HB_GLYPH_FLAG_UNSAFE_TO_CONCAT;
+}
+
+/* Runs are shaped along with up to this many characters of the text on
+ * either side, stopping at word starts. */
+#ifndef HB_SHAPE_SPLIT_OVERLAP_LENGTH
+#define HB_SHAPE_SPLIT_OVERLAP_LENGTH 32
+#endif
+
+/*
+ * hb_shape_split_run_t
+ *
+ * A run of text shaped on its own.
+ *
+ * The run is shaped with some of the text around it, such that its
+ * edges fall on cluster starts inside the shaped text, where
+ * HB_GLYPH_FLAG_UNSAFE_TO_BREAK tells whether the text could have been
+ * shaped apart there.  Used by hb_shape_parallel() and hb_shape_edit().
+ */
+
+struct hb_shape_split_run_t
+{
+  unsigned int start; /* Text range. */
+  unsigned int end;
+  hb_buffer_t *buffer; /* Owned. */
+  unsigned int glyph_start; /* Glyphs of the text range in buffer. */
+  unsigned int glyph_end;
+  bool success;
+  bool head_unsafe;
+  bool tail_unsafe;
+
+  void fini () { hb_buffer_destroy (buffer); buffer = nullptr; }
+
+  static bool is_word_start (const hb_buffer_t *text, unsigned int i)
+  {
+    return _hb_shape_split_is_word_start (text->unicode,
+					  text->info[i - 1].codepoint,
+					  text->info[i].codepoint);
+  }
+
+  /* Whether shaped text b is safe to break at the cluster of
+   * text[i]. */
+  static bool is_safe_to_break (const hb_buffer_t *text,
+				const hb_buffer_t *b,
+				unsigned int i)
+  {
+    unsigned int cluster = text->info[i].cluster;
+    bool found = false;
+    for (unsigned int j = 0; j < b->len; j++)
+      if (b->info[j].cluster == cluster)
+      {
+	if (b->info[j].mask & HB_GLYPH_FLAG_UNSAFE_TO_BREAK)
+	  return false;
+	found = true;
+      }
+    return found;
+  }
+
+  /* Shapes text[start:end] and some text around it into its own
+   * buffer.  Thread-safe. */
+  void shape (hb_shape_plan_t    *shape_plan,
+	      hb_font_t          *font,
+	      const hb_buffer_t  *text,
+	      const hb_feature_t *features,
+	      unsigned int        num_features)
+  {
+    success = false;
+
+    unsigned int count = text->len;
+    unsigned int shape_start = start;
+    unsigned int shape_end = end;
+    if (shape_start)
+      do shape_start--;
+      while (shape_start && start - shape_start < HB_SHAPE_SPLIT_OVERLAP_LENGTH && !is_word_start (text, shape_start));
+    if (shape_end < count)
+      do shape_end++;
+      while (shape_end < count && shape_end - end < HB_SHAPE_SPLIT_OVERLAP_LENGTH && !is_word_start (text, shape_end));
+
+    hb_buffer_t *b = buffer = hb_buffer_create_similar (text);
+    if (unlikely (!hb_object_is_valid (b)))
+      return;
+    b->props = text->props;
+    unsigned int flags = text->flags;
+    if (shape_start)
+      flags &= ~HB_BUFFER_FLAG_BOT;
+    if (shape_end < count)
+      flags &= ~HB_BUFFER_FLAG_EOT;
+    b->flags = (hb_buffer_flags_t) flags;
+
+    hb_buffer_append (b, text, shape_start, shape_end);
+    if (unlikely (!b->successful))
+      return;
+
+    b->enter ();
+    bool res = hb_shape_plan_execute (shape_plan, font, b, features, num_features);
+    if (b->max_ops <= 0)
+      b->shaping_failed = true;
+    b->leave ();
+
+    if (unlikely (!res || !b->successful || b->shaping_failed))
+      return;
+
+    head_unsafe = start && !is_safe_to_break (text, b, start);
+    tail_unsafe = end < count && !is_safe_to_break (text, b, end);
+
+    /* Find the glyphs of the run's own text.  They must be contiguous;
+     * if not, the run must be shaped with its neighbours instead. */
+    unsigned int cluster_start = start ? text->info[start].cluster : 0;
+    unsigned int cluster_end = end < count ? text->info[end].cluster : (unsigned int) -1;
+    glyph_start = b->len;
+    glyph_end = 0;
+    for (unsigned int j = 0; j < b->len; j++)
+      if (cluster_start <= b->info[j].cluster && b->info[j].cluster < cluster_end)
+      {
+	glyph_start = hb_min (glyph_start, j);
+	glyph_end = j + 1;
+      }
+    for (unsigned int j = glyph_start; j < glyph_end; j++)
+      if (b->info[j].cluster < cluster_start || cluster_end <= b->info[j].cluster)
+	head_unsafe = tail_unsafe = true;
+
+    success = true;
+  }
+};
+
+
+#endif /* HB_SHAPE_SPLIT_HH */
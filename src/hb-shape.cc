@@ -101,6 +101,48 @@ hb_shape_list_shapers ()
 }
 
 
+/* Shapes buffer with shape_plan, which must match its segment
+ * properties. */
+static hb_bool_t
+_hb_shape_with_plan (hb_shape_plan_t    *shape_plan,
+		     hb_font_t          *font,
+		     hb_buffer_t        *buffer,
+		     const hb_feature_t *features,
+		     unsigned int        num_features,
+		     const char * const *shaper_list)
+{
+  buffer->enter ();
+
+  hb_buffer_t *text_buffer = nullptr;
+  if (buffer->flags & HB_BUFFER_FLAG_VERIFY)
+  {
+    text_buffer = hb_buffer_create ();
+    hb_buffer_append (text_buffer, buffer, 0, -1);
+  }
+
+  hb_bool_t res = hb_shape_plan_execute (shape_plan, font, buffer, features, num_features);
+
+  if (buffer->max_ops <= 0)
+    buffer->shaping_failed = true;
+
+  if (text_buffer)
+  {
+    if (res && buffer->successful && !buffer->shaping_failed
+	    && text_buffer->successful
+	    && !buffer->verify (text_buffer,
+				font,
+				features,
+				num_features,
+				shaper_list))
+      res = false;
+    hb_buffer_destroy (text_buffer);
+  }
+
+  buffer->leave ();
+
+  return res;
+}
+
 /**
  * hb_shape_full:
  * @font: an #hb_font_t to use for shaping
@@ -129,43 +171,123 @@ hb_shape_full (hb_font_t          *font,
   if (unlikely (!buffer->len))
     return true;
 
-  buffer->enter ();
-
-  hb_buffer_t *text_buffer = nullptr;
-  if (buffer->flags & HB_BUFFER_FLAG_VERIFY)
-  {
-    text_buffer = hb_buffer_create ();
-    hb_buffer_append (text_buffer, buffer, 0, -1);
-  }
-
   hb_shape_plan_t *shape_plan = hb_shape_plan_create_cached2 (font->face, &buffer->props,
 							      features, num_features,
 							      font->coords, font->num_coords,
 							      shaper_list);
 
-  hb_bool_t res = hb_shape_plan_execute (shape_plan, font, buffer, features, num_features);
-
-  if (buffer->max_ops <= 0)
-    buffer->shaping_failed = true;
+  hb_bool_t res = _hb_shape_with_plan (shape_plan, font, buffer,
+				       features, num_features, shaper_list);
 
   hb_shape_plan_destroy (shape_plan);
 
-  if (text_buffer)
+  return res;
+}
+
+/**
+ * hb_shape_batch:
+ * @font: an #hb_font_t to use for shaping
+ * @buffers: (array length=num_buffers): the #hb_buffer_t to shape
+ * @num_buffers: the length of @buffers array
+ * @features: (array length=num_features) (nullable): an array of user
+ *    specified #hb_feature_t or %NULL
+ * @num_features: the length of @features array
+ * @shaper_list: (array zero-terminated=1) (nullable): a %NULL-terminated
+ *    array of shapers to use or %NULL
+ * @arena: (nullable): an #hb_buffer_t to collect the output in, or %NULL
+ *    to shape @buffers in place
+ * @arena_offsets: (array) (nullable): an array of @num_buffers + 1
+ *    elements to store the offset of each output in @arena to, or %NULL
+ *
+ * Shapes each of @buffers like hb_shape_full() does.  The shape plan is
+ * only looked up again when the segment properties change from one
+ * buffer to the next, so many short runs of the same script, language
+ * and direction are best shaped together, one after the other.
+ *
+ * If @arena is not %NULL, @buffers are not modified.  Instead each of
+ * them is shaped in a scratch buffer reused from one to the next, and
+ * the glyphs are appended to @arena, after clearing it, such that it
+ * holds the output of all of @buffers in order, in one array.  The
+ * output of @buffers[i] starts at @arena_offsets[i] and ends at
+ * @arena_offsets[i + 1].  The output of buffers that fail to shape is
+ * left out.
+ *
+ * Return value: false if all shapers failed for any of @buffers, true
+ * otherwise
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_shape_batch (hb_font_t          *font,
+		hb_buffer_t       **buffers,
+		unsigned int        num_buffers,
+		const hb_feature_t *features,
+		unsigned int        num_features,
+		const char * const *shaper_list,
+		hb_buffer_t        *arena,
+		unsigned int       *arena_offsets)
+{
+  hb_buffer_t *scratch = nullptr;
+  if (arena)
   {
-    if (res && buffer->successful && !buffer->shaping_failed
-	    && text_buffer->successful
-	    && !buffer->verify (text_buffer,
-				font,
-				features,
-				num_features,
-				shaper_list))
-      res = false;
-    hb_buffer_destroy (text_buffer);
+    if (unlikely (hb_object_is_immutable (arena)))
+      return false;
+    hb_buffer_clear_contents (arena);
+    scratch = hb_buffer_create ();
+    if (unlikely (!hb_object_is_valid (scratch)))
+      return false;
   }
 
-  buffer->leave ();
+  hb_bool_t ret = true;
+  hb_shape_plan_t *shape_plan = nullptr;
+  for (unsigned int i = 0; i < num_buffers; i++)
+  {
+    hb_buffer_t *buffer = buffers[i];
+    if (arena)
+    {
+      if (arena_offsets)
+	arena_offsets[i] = arena->len;
+      hb_buffer_clear_contents (scratch);
+      scratch->similar (*buffer);
+      hb_buffer_append (scratch, buffer, 0, buffer->len);
+      buffer = scratch;
+    }
+    if (unlikely (!buffer->len))
+      continue;
 
-  return res;
+    if (!shape_plan ||
+	!hb_segment_properties_equal (&shape_plan->key.props, &buffer->props))
+    {
+      hb_shape_plan_destroy (shape_plan);
+      shape_plan = hb_shape_plan_create_cached2 (font->face, &buffer->props,
+						 features, num_features,
+						 font->coords, font->num_coords,
+						 shaper_list);
+    }
+
+    if (unlikely (!buffer->successful ||
+		  !_hb_shape_with_plan (shape_plan, font, buffer,
+					features, num_features, shaper_list)))
+    {
+      ret = false;
+      continue;
+    }
+
+    if (arena)
+      hb_buffer_append (arena, scratch, 0, scratch->len);
+  }
+  hb_shape_plan_destroy (shape_plan);
+
+  if (arena)
+  {
+    if (arena_offsets)
+      arena_offsets[num_buffers] = arena->len;
+    if (unlikely (!arena->successful))
+      ret = false;
+    hb_buffer_destroy (scratch);
+  }
+
+  return ret;
 }
 
 /**
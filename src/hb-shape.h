@@ -53,10 +53,74 @@ hb_shape_full (hb_font_t          *font,
 	       unsigned int        num_features,
 	       const char * const *shaper_list);
 
+HB_EXTERN hb_bool_t
+hb_shape_batch (hb_font_t          *font,
+		hb_buffer_t       **buffers,
+		unsigned int        num_buffers,
+		const hb_feature_t *features,
+		unsigned int        num_features,
+		const char * const *shaper_list,
+		hb_buffer_t        *arena,
+		unsigned int       *arena_offsets);
+
 HB_EXTERN const char **
 hb_shape_list_shapers (void);
 
 
+/**
+ * hb_shape_task_func_t:
+ * @index: The index of the task to run
+ * @task_data: The data passed to the executor along with this function
+ *
+ * A task created by hb_shape_parallel(), to be run by an
+ * #hb_shape_executor_func_t.
+ *
+ * Since: REPLACEME
+ **/
+typedef void (*hb_shape_task_func_t) (unsigned int  index,
+				      void         *task_data);
+
+/**
+ * hb_shape_executor_func_t:
+ * @num_tasks: The number of tasks to run
+ * @task: The function running each task
+ * @task_data: Data to pass to @task
+ * @user_data: User data pointer passed to hb_shape_parallel()
+ *
+ * A callback method used by hb_shape_parallel() to run tasks
+ * concurrently.  It must call @task once with every index from zero to
+ * @num_tasks - 1, in any order and on any thread, and only return once
+ * all calls have returned.
+ *
+ * Since: REPLACEME
+ **/
+typedef void (*hb_shape_executor_func_t) (unsigned int          num_tasks,
+					  hb_shape_task_func_t  task,
+					  void                 *task_data,
+					  void                 *user_data);
+
+HB_EXTERN hb_bool_t
+hb_shape_parallel (hb_font_t                *font,
+		   hb_buffer_t              *buffer,
+		   const hb_feature_t       *features,
+		   unsigned int              num_features,
+		   const char * const       *shaper_list,
+		   hb_shape_executor_func_t  executor,
+		   void                     *user_data);
+
+HB_EXTERN hb_bool_t
+hb_shape_edit (hb_font_t          *font,
+	       hb_buffer_t        *buffer,
+	       hb_buffer_t        *text,
+	       unsigned int        offset,
+	       unsigned int        removed_length,
+	       const uint32_t     *inserted,
+	       int                 inserted_length,
+	       const hb_feature_t *features,
+	       unsigned int        num_features,
+	       const char * const *shaper_list);
+
+
 HB_END_DECLS
 
 #endif /* HB_SHAPE_H */
@@ -38,6 +38,7 @@
 #include "hb-map.h"
 #include "hb-set.h"
 #include "hb-shape.h"
+#include "hb-shape-cache.h"
 #include "hb-shape-plan.h"
 #include "hb-style.h"
 #include "hb-unicode.h"
@@ -320,6 +320,46 @@ hb_test_open_font_file (const char *font_path)
   return face;
 }
 
+
+/* Shaping helpers */
+
+/* Shapes @text with @font into a new buffer.  @feature, if not NULL, is
+ * one feature in the syntax of hb_feature_from_string(). */
+static inline hb_buffer_t *
+hb_test_shape (hb_font_t *font, const char *text, const char *feature)
+{
+  hb_buffer_t *buffer = hb_buffer_create ();
+  hb_feature_t f;
+  unsigned int num_features = 0;
+
+  if (feature)
+  {
+    g_assert (hb_feature_from_string (feature, -1, &f));
+    num_features = 1;
+  }
+
+  hb_buffer_add_utf8 (buffer, text, -1, 0, -1);
+  hb_buffer_guess_segment_properties (buffer);
+  hb_shape (font, buffer, &f, num_features);
+
+  return buffer;
+}
+
+/* Asserts that @font shapes @text like @expected_font does. */
+static inline void
+hb_test_assert_shape_equal (hb_font_t *expected_font, hb_font_t *font,
+			    const char *text, const char *feature)
+{
+  hb_buffer_t *expected = hb_test_shape (expected_font, text, feature);
+  hb_buffer_t *buffer = hb_test_shape (font, text, feature);
+
+  g_assert_cmpuint (hb_buffer_get_length (expected), >, 0);
+  g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+
+  hb_buffer_destroy (buffer);
+  hb_buffer_destroy (expected);
+}
+
 HB_END_DECLS
 
 #endif /* HB_TEST_H */
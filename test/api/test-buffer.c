@@ -856,6 +856,29 @@ test_buffer_empty (void)
   g_assert (!hb_buffer_allocation_successful (b));
 }
 
+static void
+test_buffer_create_similar (void)
+{
+  hb_buffer_t *b = hb_buffer_create ();
+  hb_buffer_t *similar;
+
+  hb_buffer_set_flags (b, HB_BUFFER_FLAG_BOT);
+  hb_buffer_set_cluster_level (b, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
+  hb_buffer_set_replacement_codepoint (b, 0x2BD1);
+  hb_buffer_set_invisible_glyph (b, 3);
+  hb_buffer_set_not_found_glyph (b, 5);
+
+  similar = hb_buffer_create_similar (b);
+  g_assert (hb_buffer_get_flags (similar) == HB_BUFFER_FLAG_BOT);
+  g_assert (hb_buffer_get_cluster_level (similar) == HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
+  g_assert_cmphex (hb_buffer_get_replacement_codepoint (similar), ==, 0x2BD1);
+  g_assert_cmpuint (hb_buffer_get_invisible_glyph (similar), ==, 3);
+  g_assert_cmpuint (hb_buffer_get_not_found_glyph (similar), ==, 5);
+
+  hb_buffer_destroy (similar);
+  hb_buffer_destroy (b);
+}
+
 typedef struct {
   const char *contents;
   hb_buffer_serialize_format_t format;
@@ -948,6 +971,7 @@ main (int argc, char **argv)
   hb_test_add (test_buffer_utf16_conversion);
   hb_test_add (test_buffer_utf32_conversion);
   hb_test_add (test_buffer_empty);
+  hb_test_add (test_buffer_create_similar);
   hb_test_add (test_buffer_serialize_deserialize);
 
   return hb_test_run();
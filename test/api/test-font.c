@@ -26,6 +26,8 @@
 
 #include "hb-test.h"
 
+#include <hb-ot.h>
+
 /* Unit tests for hb-font.h */
 
 
@@ -598,6 +600,58 @@ test_font_properties (void)
   hb_font_destroy (subfont);
 }
 
+static void
+test_font_freeze (void)
+{
+  hb_face_t *face;
+  hb_font_t *font, *subfont, *other;
+  hb_position_t advance;
+  unsigned int hits, misses, hits_after, misses_after;
+
+  /* Inert objects are left alone. */
+  hb_face_freeze (hb_face_get_empty ());
+  hb_font_freeze (hb_font_get_empty ());
+
+  face = hb_test_open_font_file ("fonts/SourceSerifVariable-Roman-VVAR.abc.ttf");
+  font = hb_font_create (face);
+  float coords[1] = { 700.0f };
+  hb_font_set_var_coords_design (font, coords, 1);
+  advance = hb_font_get_glyph_h_advance (font, 1);
+
+  subfont = hb_font_create_sub_font (font);
+  g_assert (!hb_font_is_immutable (font));
+
+  hb_font_freeze (subfont);
+  g_assert (hb_face_is_immutable (face));
+  g_assert (hb_font_is_immutable (font));
+  g_assert (hb_font_is_immutable (subfont));
+
+  /* Frozen fonts cannot be changed anymore, but work as before. */
+  hb_font_set_scale (subfont, 10, 10);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (subfont, 1), ==, advance);
+  g_assert_cmpint (hb_face_get_upem (face), ==, 1000);
+
+  /* Freezing sets up the advance cache of the coordinates of the font,
+   * instead of the first call needing it. */
+  other = hb_font_create (face);
+  coords[0] = 400.0f;
+  hb_font_set_var_coords_design (other, coords, 1);
+  hb_ot_font_get_advance_cache_stats (other, &hits, &misses, NULL);
+  hb_font_freeze (other);
+  hb_ot_font_get_advance_cache_stats (other, &hits_after, &misses_after, NULL);
+  g_assert_cmpuint (misses_after, ==, misses + 1);
+  g_assert_cmpuint (hits_after, ==, hits);
+  hb_font_get_glyph_h_advance (other, 1);
+  hb_ot_font_get_advance_cache_stats (other, &hits, &misses, NULL);
+  g_assert_cmpuint (misses, ==, misses_after);
+  g_assert_cmpuint (hits, ==, hits_after);
+
+  hb_font_destroy (other);
+  hb_font_destroy (subfont);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -614,6 +668,7 @@ main (int argc, char **argv)
 
   hb_test_add (test_font_empty);
   hb_test_add (test_font_properties);
+  hb_test_add (test_font_freeze);
 
   return hb_test_run();
 }
@@ -215,6 +215,106 @@ test_ot_layout_language_get_feature_tags (void)
   hb_face_destroy (face);
 }
 
+static void
+test_ot_layout_table_find_feature_variations (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/TestCFF2VF.otf");
+
+  /* The one record applies from -1.0 to 0.367 on the only axis.  Queries
+   * repeat to hit results cached for the range they fall in. */
+  const struct {
+    int coord;
+    hb_bool_t found;
+  } tests[] = {
+    {0, TRUE}, {6014, TRUE}, {6015, FALSE}, {-16384, TRUE},
+    {16384, FALSE}, {6000, TRUE}, {0, TRUE}, {6015, FALSE},
+    {6014, TRUE}, {10000, FALSE},
+  };
+  for (unsigned int i = 0; i < G_N_ELEMENTS (tests); i++)
+  {
+    unsigned int index = 1234;
+    g_assert_cmpint (tests[i].found, ==,
+		     hb_ot_layout_table_find_feature_variations (face, HB_OT_TAG_GSUB,
+								 &tests[i].coord, 1,
+								 &index));
+    g_assert_cmpuint (index, ==, tests[i].found ? 0 : HB_OT_LAYOUT_NO_VARIATIONS_INDEX);
+  }
+
+  unsigned int index = 1234;
+  g_assert (hb_ot_layout_table_find_feature_variations (face, HB_OT_TAG_GSUB, NULL, 0, &index));
+  g_assert_cmpuint (index, ==, 0);
+  g_assert (!hb_ot_layout_table_find_feature_variations (face, HB_OT_TAG_GPOS, NULL, 0, &index));
+  g_assert_cmpuint (index, ==, HB_OT_LAYOUT_NO_VARIATIONS_INDEX);
+
+  hb_face_destroy (face);
+}
+
+static void
+test_ot_layout_snapshot (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/NotoNastaliqUrdu-Regular.ttf");
+  hb_face_t *adopted = hb_test_open_font_file ("fonts/NotoNastaliqUrdu-Regular.ttf");
+  hb_face_t *other = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_face_t *edited;
+  hb_font_t *font, *adopted_font;
+  const char *text = "\xd9\x85\xdb\x8c\xd8\xb1\xd8\xa7 \xd9\x86\xd8\xa7\xd9\x85 \xd8\xb4\xd9\x86\xd8\xa7\xd8\xb3\xdb\x8c";
+  const char *features[] = {"kern", "-liga"};
+  hb_buffer_t *buffer;
+  hb_segment_properties_t props;
+  hb_shape_plan_t *plan;
+  hb_blob_t *snapshot, *bad, *font_blob, *gsub;
+  char *data;
+  unsigned int i, length;
+
+  font = hb_font_create (face);
+  buffer = hb_test_shape (font, text, NULL);
+  hb_buffer_get_segment_properties (buffer, &props);
+  hb_buffer_destroy (buffer);
+  plan = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  snapshot = hb_ot_layout_create_snapshot (face, &plan, 1);
+  hb_shape_plan_destroy (plan);
+  g_assert_cmpuint (hb_blob_get_length (snapshot), >, 0);
+
+  /* Snapshots of other fonts, and damaged ones, are not adopted. */
+  g_assert (!hb_ot_layout_adopt_snapshot (other, snapshot));
+  data = (char *) hb_blob_get_data (snapshot, &length);
+  bad = hb_blob_create_sub_blob (snapshot, 0, length - 8);
+  g_assert (!hb_ot_layout_adopt_snapshot (adopted, bad));
+  hb_blob_destroy (bad);
+  bad = hb_blob_create (data, length, HB_MEMORY_MODE_DUPLICATE, NULL, NULL);
+  hb_blob_get_data_writable (bad, NULL)[0] ^= 1;
+  g_assert (!hb_ot_layout_adopt_snapshot (adopted, bad));
+  hb_blob_destroy (bad);
+
+  /* Nor are snapshots of a font with other GSUB data, though the table
+   * directory still has the old checksum. */
+  font_blob = hb_face_reference_blob (face);
+  gsub = hb_face_reference_table (face, HB_OT_TAG_GSUB);
+  bad = hb_blob_create (hb_blob_get_data (font_blob, NULL), hb_blob_get_length (font_blob),
+			HB_MEMORY_MODE_DUPLICATE, NULL, NULL);
+  hb_blob_get_data_writable (bad, NULL)[hb_blob_get_data (gsub, NULL) - hb_blob_get_data (font_blob, NULL) + hb_blob_get_length (gsub) - 1] ^= 1;
+  edited = hb_face_create (bad, 0);
+  g_assert (!hb_ot_layout_adopt_snapshot (edited, snapshot));
+  hb_face_destroy (edited);
+  hb_blob_destroy (bad);
+  hb_blob_destroy (gsub);
+  hb_blob_destroy (font_blob);
+
+  g_assert (hb_ot_layout_adopt_snapshot (adopted, snapshot));
+  g_assert (!hb_ot_layout_adopt_snapshot (adopted, snapshot));
+
+  adopted_font = hb_font_create (adopted);
+  for (i = 0; i < G_N_ELEMENTS (features); i++)
+    hb_test_assert_shape_equal (font, adopted_font, text, features[i]);
+
+  hb_font_destroy (adopted_font);
+  hb_font_destroy (font);
+  hb_blob_destroy (snapshot);
+  hb_face_destroy (other);
+  hb_face_destroy (adopted);
+  hb_face_destroy (face);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -224,5 +324,7 @@ main (int argc, char **argv)
   hb_test_add (test_ot_layout_script_get_language_tags);
   hb_test_add (test_ot_layout_table_get_feature_tags);
   hb_test_add (test_ot_layout_language_get_feature_tags);
+  hb_test_add (test_ot_layout_table_find_feature_variations);
+  hb_test_add (test_ot_layout_snapshot);
   return hb_test_run ();
 }
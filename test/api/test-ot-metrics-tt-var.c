@@ -133,6 +133,68 @@ test_advance_tt_var_hvarvvar (void)
   hb_font_destroy (font);
 }
 
+static void
+test_advance_tt_var_cache (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/SourceSerifVariable-Roman-VVAR.abc.ttf");
+  g_assert (face);
+  hb_font_t *font = hb_font_create (face);
+  g_assert (font);
+  hb_ot_font_set_funcs (font);
+
+  unsigned int hits, misses, evictions;
+  hb_ot_font_get_advance_cache_stats (font, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 0);
+  g_assert_cmpuint (misses, ==, 0);
+  g_assert_cmpuint (evictions, ==, 0);
+
+  float bold[1] = { 700.0f };
+  float light[1] = { 300.0f };
+  hb_position_t x;
+
+  hb_font_set_var_coords_design (font, bold, 1);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (font, 1), ==, 531);
+  hb_font_set_var_coords_design (font, light, 1);
+  x = hb_font_get_glyph_h_advance (font, 1);
+
+  /* Switching back reuses the instances cached above. */
+  hb_font_set_var_coords_design (font, bold, 1);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (font, 1), ==, 531);
+  hb_font_set_var_coords_design (font, light, 1);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (font, 1), ==, x);
+
+  hb_ot_font_get_advance_cache_stats (font, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 2);
+  g_assert_cmpuint (misses, ==, 2);
+  g_assert_cmpuint (evictions, ==, 0);
+
+  /* As do other fonts of the same face. */
+  hb_font_t *font2 = hb_font_create (face);
+  hb_ot_font_set_funcs (font2);
+  hb_font_set_var_coords_design (font2, bold, 1);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (font2, 1), ==, 531);
+
+  hb_ot_font_get_advance_cache_stats (font2, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 3);
+  g_assert_cmpuint (misses, ==, 2);
+
+  for (unsigned int i = 0; i < 16; i++)
+  {
+    float coords[1] = { 300.0f + 25.0f * i };
+    hb_font_set_var_coords_design (font2, coords, 1);
+    hb_font_get_glyph_h_advance (font2, 1);
+  }
+  hb_ot_font_get_advance_cache_stats (font, NULL, NULL, &evictions);
+  g_assert_cmpuint (evictions, >, 0);
+
+  hb_font_set_var_coords_design (font, bold, 1);
+  g_assert_cmpint (hb_font_get_glyph_h_advance (font, 1), ==, 531);
+
+  hb_font_destroy (font2);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
 static void
 test_advance_tt_var_anchor (void)
 {
@@ -259,6 +321,7 @@ main (int argc, char **argv)
   hb_test_add (test_extents_tt_var);
   hb_test_add (test_advance_tt_var_nohvar);
   hb_test_add (test_advance_tt_var_hvarvvar);
+  hb_test_add (test_advance_tt_var_cache);
   hb_test_add (test_advance_tt_var_anchor);
   hb_test_add (test_extents_tt_var_comp);
   hb_test_add (test_advance_tt_var_comp_v);
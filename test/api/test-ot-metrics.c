@@ -68,11 +68,100 @@ test_ot_metrics_get_var (void)
   hb_face_destroy (face);
 }
 
+/* Metrics, advances and extents follow coordinate changes on the same
+ * font, though the font keeps region scalars between calls. */
+static void
+test_ot_metrics_var_cache (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/TestCFF2VF.otf");
+  hb_font_t *font = hb_font_create (face);
+  float weights[] = {100.f, 900.f, 400.f, 100.f};
+  unsigned int i;
+  hb_codepoint_t gid;
+
+  for (i = 0; i < G_N_ELEMENTS (weights); i++)
+  {
+    hb_font_t *fresh = hb_font_create (face);
+    hb_position_t value, expected;
+
+    hb_font_set_var_coords_design (font, &weights[i], 1);
+    hb_font_set_var_coords_design (fresh, &weights[i], 1);
+
+    g_assert (hb_ot_metrics_get_position (font, HB_OT_METRICS_TAG_X_HEIGHT, &value));
+    g_assert (hb_ot_metrics_get_position (fresh, HB_OT_METRICS_TAG_X_HEIGHT, &expected));
+    g_assert_cmpint (value, ==, expected);
+
+    for (gid = 1; gid < 4; gid++)
+    {
+      hb_glyph_extents_t extents, expected_extents;
+      g_assert (hb_font_get_glyph_extents (font, gid, &extents));
+      g_assert (hb_font_get_glyph_extents (fresh, gid, &expected_extents));
+      g_assert_cmpint (extents.x_bearing, ==, expected_extents.x_bearing);
+      g_assert_cmpint (extents.y_bearing, ==, expected_extents.y_bearing);
+      g_assert_cmpint (extents.width, ==, expected_extents.width);
+      g_assert_cmpint (extents.height, ==, expected_extents.height);
+      g_assert_cmpint (hb_font_get_glyph_h_advance (font, gid), ==,
+		       hb_font_get_glyph_h_advance (fresh, gid));
+    }
+
+    hb_font_destroy (fresh);
+  }
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+/* The region scalars a font keeps are of its face's tables; they must
+ * not outlive a change of face. */
+static void
+test_ot_metrics_var_cache_set_face (void)
+{
+  hb_face_t *faces[] = {hb_test_open_font_file ("fonts/SourceSansVariable-Roman.abc.ttf"),
+			hb_test_open_font_file ("fonts/AdobeVFPrototype-Subset.otf"),
+			hb_test_open_font_file ("fonts/SourceSansVariable-Roman.abc.ttf")};
+  hb_font_t *font = hb_font_create (faces[0]);
+  hb_variation_t wght = {HB_TAG ('w','g','h','t'), 700.f};
+  hb_codepoint_t gids[] = {1, 2, 3};
+  hb_position_t advances[G_N_ELEMENTS (gids)], expected[G_N_ELEMENTS (gids)];
+  unsigned int i, j;
+
+  hb_font_set_variations (font, &wght, 1);
+  hb_font_get_glyph_h_advances (font, G_N_ELEMENTS (gids), gids, sizeof (gids[0]),
+				advances, sizeof (advances[0]));
+
+  for (i = 1; i < G_N_ELEMENTS (faces); i++)
+  {
+    hb_font_t *fresh = hb_font_create (faces[i]);
+    const int *coords;
+    unsigned int num_coords;
+
+    /* The font keeps its coordinates. */
+    hb_font_set_face (font, faces[i]);
+    hb_ot_font_set_funcs (font);
+    coords = hb_font_get_var_coords_normalized (font, &num_coords);
+    hb_font_set_var_coords_normalized (fresh, coords, num_coords);
+
+    hb_font_get_glyph_h_advances (font, G_N_ELEMENTS (gids), gids, sizeof (gids[0]),
+				  advances, sizeof (advances[0]));
+    hb_font_get_glyph_h_advances (fresh, G_N_ELEMENTS (gids), gids, sizeof (gids[0]),
+				  expected, sizeof (expected[0]));
+    for (j = 0; j < G_N_ELEMENTS (gids); j++)
+      g_assert_cmpint (advances[j], ==, expected[j]);
+
+    hb_font_destroy (fresh);
+  }
+
+  hb_font_destroy (font);
+  for (i = 0; i < G_N_ELEMENTS (faces); i++)
+    hb_face_destroy (faces[i]);
+}
+
 int
 main (int argc, char **argv)
 {
   hb_test_init (&argc, &argv);
   hb_test_add (test_ot_metrics_get_no_var);
   hb_test_add (test_ot_metrics_get_var);
+  hb_test_add (test_ot_metrics_var_cache);
+  hb_test_add (test_ot_metrics_var_cache_set_face);
   return hb_test_run ();
 }
@@ -180,6 +180,490 @@ test_shape_clusters (void)
 }
 
 
+static void
+test_shape_plan_cache (void)
+{
+  hb_face_t *face;
+  hb_segment_properties_t props = HB_SEGMENT_PROPERTIES_DEFAULT;
+  hb_feature_t features[3];
+  hb_shape_plan_t *plan1, *plan2;
+  unsigned int hits, misses, evictions, i;
+
+  face = hb_face_create (NULL, 0);
+  props.direction = HB_DIRECTION_LTR;
+  props.script = HB_SCRIPT_LATIN;
+
+  g_assert_cmpuint (hb_face_get_shape_plan_cache_size (face), >, 0);
+
+  plan1 = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  plan2 = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  g_assert (plan1 == plan2);
+  hb_shape_plan_destroy (plan1);
+  hb_shape_plan_destroy (plan2);
+
+  hb_face_get_shape_plan_cache_stats (face, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 1);
+  g_assert_cmpuint (misses, ==, 1);
+  g_assert_cmpuint (evictions, ==, 0);
+
+  hb_face_set_shape_plan_cache_size (face, 2);
+  g_assert_cmpuint (hb_face_get_shape_plan_cache_size (face), ==, 2);
+
+  g_assert (hb_feature_from_string ("kern=0", -1, &features[0]));
+  g_assert (hb_feature_from_string ("liga=0", -1, &features[1]));
+  g_assert (hb_feature_from_string ("smcp", -1, &features[2]));
+  for (i = 0; i < 3; i++)
+  {
+    plan1 = hb_shape_plan_create_cached (face, &props, &features[i], 1, NULL);
+    hb_shape_plan_destroy (plan1);
+  }
+
+  hb_face_get_shape_plan_cache_stats (face, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 1);
+  g_assert_cmpuint (misses, ==, 4);
+  g_assert_cmpuint (evictions, ==, 2);
+
+  /* Most recent plan must have survived. */
+  plan1 = hb_shape_plan_create_cached (face, &props, &features[2], 1, NULL);
+  hb_shape_plan_destroy (plan1);
+  hb_face_get_shape_plan_cache_stats (face, &hits, NULL, NULL);
+  g_assert_cmpuint (hits, ==, 2);
+
+  hb_face_set_shape_plan_cache_size (face, 0);
+  plan1 = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  plan2 = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  g_assert (plan1 != plan2);
+  hb_shape_plan_destroy (plan1);
+  hb_shape_plan_destroy (plan2);
+
+  hb_face_get_shape_plan_cache_stats (face, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 2);
+  g_assert_cmpuint (misses, ==, 6);
+  g_assert_cmpuint (evictions, ==, 4);
+
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_plan_derive (void)
+{
+  /* Plans derived from the cached plan without features must match
+   * plans compiled on their own. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_face_t *fresh_face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font, *fresh_font;
+  const char *features[] = {"liga[1:3]=0", "-liga", "kern[0:4]=0", "smcp", "dlig[5:9]", "ss01=2"};
+  const char *text = "office fit ffi";
+  hb_buffer_t *plain;
+  unsigned int hits, misses, hits_after, misses_after, i;
+
+  hb_face_set_shape_plan_cache_size (fresh_face, 0);
+  font = hb_font_create (face);
+  fresh_font = hb_font_create (fresh_face);
+  plain = hb_test_shape (font, text, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (features); i++)
+  {
+    if (i < 2)
+    {
+      hb_buffer_t *expected = hb_test_shape (fresh_font, text, features[i]);
+      g_assert_cmpuint (hb_buffer_diff (plain, expected, (hb_codepoint_t) -1, 0), !=, HB_BUFFER_DIFF_FLAG_EQUAL);
+      hb_buffer_destroy (expected);
+    }
+
+    /* The derived plan is cached, and found there the next time. */
+    hb_face_get_shape_plan_cache_stats (face, &hits, &misses, NULL);
+    hb_test_assert_shape_equal (fresh_font, font, text, features[i]);
+    hb_face_get_shape_plan_cache_stats (face, &hits_after, &misses_after, NULL);
+    g_assert_cmpuint (hits_after, ==, hits);
+    g_assert_cmpuint (misses_after, ==, misses + 1);
+
+    hb_test_assert_shape_equal (fresh_font, font, text, features[i]);
+    hb_face_get_shape_plan_cache_stats (face, &hits, &misses, NULL);
+    g_assert_cmpuint (hits, ==, hits_after + 1);
+    g_assert_cmpuint (misses, ==, misses_after);
+  }
+
+  hb_buffer_destroy (plain);
+  hb_font_destroy (fresh_font);
+  hb_font_destroy (font);
+  hb_face_destroy (fresh_face);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_flat_layout (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/NotoNastaliqUrdu-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  const char *text = "\xd9\x85\xdb\x8c\xd8\xb1\xd8\xa7 \xd9\x86\xd8\xa7\xd9\x85 \xd8\xb4\xd9\x86\xd8\xa7\xd8\xb3\xdb\x8c";
+  /* From too small for any table, through running out halfway, to
+   * enough for all of them. */
+  unsigned int budgets[] = {1, 64, 4096, 16 << 20};
+  unsigned int i;
+
+  g_assert_cmpuint (hb_face_get_flat_layout_budget (hb_face_get_empty ()), ==, 0);
+  g_assert_cmpuint (hb_face_get_flat_layout_budget (face), ==, 0);
+
+  /* Whichever tables fit the budget, the others are used as they are,
+   * and the results are the same. */
+  for (i = 0; i < G_N_ELEMENTS (budgets); i++)
+  {
+    hb_face_t *flat_face = hb_test_open_font_file ("fonts/NotoNastaliqUrdu-Regular.ttf");
+    hb_font_t *flat_font;
+
+    hb_face_set_flat_layout_budget (flat_face, budgets[i]);
+    g_assert_cmpuint (hb_face_get_flat_layout_budget (flat_face), ==, budgets[i]);
+    flat_font = hb_font_create (flat_face);
+
+    hb_test_assert_shape_equal (font, flat_font, text, NULL);
+
+    hb_font_destroy (flat_font);
+    hb_face_destroy (flat_face);
+  }
+
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+/* Returns the total kerning of "WAW AVA". */
+static hb_position_t
+get_kerning (hb_font_t *font)
+{
+  hb_buffer_t *kerned = hb_test_shape (font, "WAW AVA", "kern");
+  hb_buffer_t *unkerned = hb_test_shape (font, "WAW AVA", "-kern");
+  hb_glyph_position_t *kerned_pos = hb_buffer_get_glyph_positions (kerned, NULL);
+  hb_glyph_position_t *unkerned_pos = hb_buffer_get_glyph_positions (unkerned, NULL);
+  hb_position_t kerning = 0;
+  unsigned int i;
+
+  g_assert_cmpuint (hb_buffer_get_length (kerned), ==, hb_buffer_get_length (unkerned));
+  for (i = 0; i < hb_buffer_get_length (kerned); i++)
+    kerning += kerned_pos[i].x_advance - unkerned_pos[i].x_advance;
+
+  hb_buffer_destroy (unkerned);
+  hb_buffer_destroy (kerned);
+  return kerning;
+}
+
+static void
+test_shape_flat_layout_kern (void)
+{
+  /* Pair positioning of both formats, with Device tables. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/AdobeVFPrototype.WA.gpos.otf");
+  hb_face_t *flat_face = hb_test_open_font_file ("fonts/AdobeVFPrototype.WA.gpos.otf");
+  hb_variation_t wght = {HB_TAG ('w','g','h','t'), 800};
+  hb_position_t kerning[2];
+  unsigned int i;
+
+  hb_face_set_flat_layout_budget (flat_face, 16 << 20);
+
+  /* Decoded values are used without variations; with them, which change
+   * the kerning, the pair tables are used instead. */
+  for (i = 0; i < 2; i++)
+  {
+    hb_font_t *font = hb_font_create (face);
+    hb_font_t *flat_font = hb_font_create (flat_face);
+
+    hb_font_set_variations (font, &wght, i);
+    hb_font_set_variations (flat_font, &wght, i);
+
+    kerning[i] = get_kerning (font);
+    g_assert_cmpint (kerning[i], !=, 0);
+    hb_test_assert_shape_equal (font, flat_font, "WAW AVA", "kern");
+
+    hb_font_destroy (flat_font);
+    hb_font_destroy (font);
+  }
+  g_assert_cmpint (kerning[0], !=, kerning[1]);
+
+  hb_face_destroy (flat_face);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_flat_layout_unsorted_pairs (void)
+{
+  /* The pair set of "a" has duplicate records, out of order. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/PairPos-unsorted.ttf");
+  hb_face_t *flat_face = hb_test_open_font_file ("fonts/PairPos-unsorted.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_font_t *flat_font;
+  hb_buffer_t *expected;
+
+  hb_face_set_flat_layout_budget (flat_face, 16 << 20);
+  flat_font = hb_font_create (flat_face);
+
+  expected = hb_test_shape (font, "ab ac ad ba", NULL);
+  g_assert_cmpint (hb_buffer_get_glyph_positions (expected, NULL)[0].x_advance, <, 500);
+  hb_buffer_destroy (expected);
+
+  hb_test_assert_shape_equal (font, flat_font, "ab ac ad ba", NULL);
+
+  hb_font_destroy (flat_font);
+  hb_font_destroy (font);
+  hb_face_destroy (flat_face);
+  hb_face_destroy (face);
+}
+
+static void
+shape_ligature_zwj_run (hb_font_t *font, hb_buffer_flags_t flags, hb_buffer_t *buffer)
+{
+  unsigned int i;
+
+  hb_buffer_set_flags (buffer, flags);
+  hb_buffer_add_utf8 (buffer, "ff", -1, 0, -1);
+  for (i = 0; i < 10000; i++)
+    hb_buffer_add_utf8 (buffer, "\xe2\x80\x8d", -1, 0, -1);
+  hb_buffer_add_utf8 (buffer, "ifl", -1, 0, -1);
+  hb_buffer_guess_segment_properties (buffer);
+  hb_shape (font, buffer, NULL, 0);
+}
+
+static void
+test_shape_ligature_zwj_run (void)
+{
+  /* Ligature sets big enough to be searched through a trie. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/SourceSansPro-Regular.otf");
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *expected = hb_buffer_create ();
+  hb_buffer_t *buffer = hb_buffer_create ();
+
+  /* Producing unsafe-to-concat flags tries every ligature in turn. */
+  shape_ligature_zwj_run (font, HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT, expected);
+  shape_ligature_zwj_run (font, HB_BUFFER_FLAG_DEFAULT, buffer);
+
+  g_assert_cmpuint (hb_buffer_get_length (buffer), >, 10000);
+  g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0) & ~HB_BUFFER_DIFF_FLAG_GLYPH_FLAGS_MISMATCH,
+		    ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+
+  hb_buffer_destroy (buffer);
+  hb_buffer_destroy (expected);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_var_deltas (void)
+{
+  /* Deltas memoized by a font must follow its coordinates. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/AdobeVFPrototype.WA.gpos.otf");
+  hb_font_t *font = hb_font_create (face);
+  float weights[] = {800, 200, 800, 400};
+  hb_position_t kerning[G_N_ELEMENTS (weights)];
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (weights); i++)
+  {
+    hb_variation_t wght = {HB_TAG ('w','g','h','t'), weights[i]};
+    hb_font_t *fresh_font = hb_font_create (face);
+
+    hb_font_set_variations (fresh_font, &wght, 1);
+    hb_font_set_variations (font, &wght, 1);
+
+    /* Deltas of the previous coordinates would change the kerning. */
+    kerning[i] = get_kerning (fresh_font);
+    if (i)
+      g_assert_cmpint (kerning[i], !=, kerning[i - 1]);
+    hb_test_assert_shape_equal (fresh_font, font, "WAW AVA", "kern");
+
+    hb_font_destroy (fresh_font);
+  }
+
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_cache (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_shape_cache_t *cache = hb_shape_cache_create (2);
+  const char *texts[] = {"To find the office", "To find the office", "AVAVA fi  fl", "To find"};
+  unsigned int hits, misses, evictions, i;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_buffer_t *expected = hb_buffer_create ();
+    hb_buffer_t *buffer = hb_buffer_create ();
+
+    hb_buffer_add_utf8 (expected, texts[i], -1, 0, -1);
+    hb_buffer_guess_segment_properties (expected);
+    hb_shape (font, expected, NULL, 0);
+
+    hb_buffer_add_utf8 (buffer, texts[i], -1, 0, -1);
+    hb_buffer_guess_segment_properties (buffer);
+    g_assert (hb_shape_cached (cache, font, buffer, NULL, 0, NULL));
+
+    g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+
+    hb_buffer_destroy (buffer);
+    hb_buffer_destroy (expected);
+  }
+
+  hb_shape_cache_get_stats (cache, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, >, 0);
+  g_assert_cmpuint (misses, >, 0);
+  g_assert_cmpuint (evictions, >, 0);
+
+  hb_shape_cache_destroy (cache);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_cache_evict (void)
+{
+  /* Words are looked up again right after being evicted. */
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_shape_cache_t *cache = hb_shape_cache_create (1);
+  const char *texts[] = {"office", "AVAVA", "office", "AVAVA", "AVAVA"};
+  unsigned int hits, misses, evictions, i;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_buffer_t *expected = hb_test_shape (font, texts[i], NULL);
+    hb_buffer_t *buffer = hb_buffer_create ();
+
+    hb_buffer_add_utf8 (buffer, texts[i], -1, 0, -1);
+    hb_buffer_guess_segment_properties (buffer);
+    g_assert (hb_shape_cached (cache, font, buffer, NULL, 0, NULL));
+
+    g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+
+    hb_buffer_destroy (buffer);
+    hb_buffer_destroy (expected);
+  }
+
+  hb_shape_cache_get_stats (cache, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, ==, 1);
+  g_assert_cmpuint (misses, ==, 4);
+  g_assert_cmpuint (evictions, ==, 3);
+
+  hb_shape_cache_destroy (cache);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static hb_bool_t
+count_message (hb_buffer_t *buffer HB_UNUSED, hb_font_t *font HB_UNUSED,
+	       const char *message HB_UNUSED, void *user_data)
+{
+  (*(unsigned int *) user_data)++;
+  return TRUE;
+}
+
+static void
+test_shape_cache_fallback (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_shape_cache_t *cache = hb_shape_cache_create (16);
+  const char *text = "To find the office";
+  unsigned int expected_messages, messages, hits, misses, evictions, i;
+
+  /* Warm the cache with the words of the text. */
+  for (i = 0; i < 2; i++)
+  {
+    hb_buffer_t *buffer = hb_buffer_create ();
+    hb_buffer_add_utf8 (buffer, text, -1, 0, -1);
+    hb_buffer_guess_segment_properties (buffer);
+    g_assert (hb_shape_cached (cache, font, buffer, NULL, 0, NULL));
+    hb_buffer_destroy (buffer);
+  }
+  hb_shape_cache_get_stats (cache, &hits, &misses, &evictions);
+  g_assert_cmpuint (hits, >, 0);
+
+  /* Buffers with a message function, and ones producing unsafe-to-concat
+   * flags, are shaped whole, and do not use the cache. */
+  for (i = 0; i < 2; i++)
+  {
+    hb_buffer_t *expected = hb_buffer_create ();
+    hb_buffer_t *buffer = hb_buffer_create ();
+    unsigned int hits_after, misses_after;
+
+    messages = expected_messages = 0;
+    if (i)
+    {
+      hb_buffer_set_flags (expected, HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT);
+      hb_buffer_set_flags (buffer, HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT);
+    }
+    else
+    {
+      hb_buffer_set_message_func (expected, count_message, &expected_messages, NULL);
+      hb_buffer_set_message_func (buffer, count_message, &messages, NULL);
+    }
+
+    hb_buffer_add_utf8 (expected, text, -1, 0, -1);
+    hb_buffer_guess_segment_properties (expected);
+    hb_shape (font, expected, NULL, 0);
+
+    hb_buffer_add_utf8 (buffer, text, -1, 0, -1);
+    hb_buffer_guess_segment_properties (buffer);
+    g_assert (hb_shape_cached (cache, font, buffer, NULL, 0, NULL));
+
+    g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+    g_assert_cmpuint (messages, ==, expected_messages);
+    if (!i)
+      g_assert_cmpuint (expected_messages, >, 0);
+    hb_shape_cache_get_stats (cache, &hits_after, &misses_after, NULL);
+    g_assert_cmpuint (hits_after, ==, hits);
+    g_assert_cmpuint (misses_after, ==, misses);
+
+    hb_buffer_destroy (buffer);
+    hb_buffer_destroy (expected);
+  }
+
+  hb_shape_cache_destroy (cache);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+serial_executor (unsigned int          num_tasks,
+		 hb_shape_task_func_t  task,
+		 void                 *task_data,
+		 void                 *user_data)
+{
+  unsigned int i;
+  *(unsigned int *) user_data += num_tasks;
+  /* Run backwards, to catch dependencies between tasks. */
+  for (i = num_tasks; i; i--)
+    task (i - 1, task_data);
+}
+
+static void
+test_shape_parallel (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *expected = hb_buffer_create ();
+  hb_buffer_t *buffer = hb_buffer_create ();
+  const char *words = "To find the office, AVAVA fi fl Te Yo. ";
+  char text[8192] = "";
+  unsigned int num_tasks = 0, i;
+
+  for (i = 0; i < 200; i++)
+    strcat (text, words);
+  hb_buffer_add_utf8 (expected, text, -1, 0, -1);
+  hb_buffer_add_utf8 (buffer, text, -1, 0, -1);
+  hb_buffer_guess_segment_properties (expected);
+  hb_buffer_guess_segment_properties (buffer);
+
+  hb_shape (font, expected, NULL, 0);
+  g_assert (hb_shape_parallel (font, buffer, NULL, 0, NULL, serial_executor, &num_tasks));
+
+  g_assert_cmpuint (num_tasks, >, 1);
+  g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+
+  hb_buffer_destroy (buffer);
+  hb_buffer_destroy (expected);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
 static void
 test_shape_list (void)
 {
@@ -193,6 +677,117 @@ test_shape_list (void)
   g_assert (!strcmp (shapers[i - 1], "fallback"));
 }
 
+static void
+test_shape_batch (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *expected = hb_buffer_create ();
+  hb_buffer_t *output = hb_buffer_create ();
+  hb_buffer_t *arena = hb_buffer_create ();
+  const char *texts[] = {"office", "AVAVA", "", "Te Yo", "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d", "fi fl"};
+  hb_buffer_t *buffers[G_N_ELEMENTS (texts)];
+  unsigned int offsets[G_N_ELEMENTS (texts) + 1];
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    buffers[i] = hb_buffer_create ();
+    hb_buffer_add_utf8 (buffers[i], texts[i], -1, 0, -1);
+    hb_buffer_guess_segment_properties (buffers[i]);
+  }
+
+  g_assert (hb_shape_batch (font, buffers, G_N_ELEMENTS (texts), NULL, 0, NULL, arena, offsets));
+  g_assert_cmpuint (offsets[0], ==, 0);
+  g_assert_cmpuint (offsets[G_N_ELEMENTS (texts)], ==, hb_buffer_get_length (arena));
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_buffer_clear_contents (expected);
+    hb_buffer_append (expected, buffers[i], 0, -1);
+    hb_shape (font, expected, NULL, 0);
+
+    hb_buffer_clear_contents (output);
+    hb_buffer_append (output, arena, offsets[i], offsets[i + 1]);
+    g_assert_cmpuint (hb_buffer_diff (output, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+  }
+
+  g_assert (hb_shape_batch (font, buffers, G_N_ELEMENTS (texts), NULL, 0, NULL, NULL, NULL));
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_buffer_clear_contents (expected);
+    hb_buffer_add_utf8 (expected, texts[i], -1, 0, -1);
+    hb_buffer_guess_segment_properties (expected);
+    hb_shape (font, expected, NULL, 0);
+
+    g_assert_cmpuint (hb_buffer_diff (buffers[i], expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+    hb_buffer_destroy (buffers[i]);
+  }
+
+  hb_buffer_destroy (arena);
+  hb_buffer_destroy (output);
+  hb_buffer_destroy (expected);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+test_shape_edit (void)
+{
+  hb_face_t *face = hb_test_open_font_file ("fonts/OpenSans-Regular.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *expected = hb_buffer_create ();
+  hb_buffer_t *buffer = hb_buffer_create ();
+  hb_buffer_t *text = hb_buffer_create ();
+  const char *words = "To find the office, AVAVA fi fl Te Yo. ";
+  uint32_t codepoints[800];
+  const struct {
+    unsigned int offset;
+    unsigned int removed_length;
+    const uint32_t inserted[4];
+  } edits[] = {
+    {400, 0, {'f', 'f', 'i'}},
+    {3, 4, {0}},
+    {0, 0, {'A', 'V'}},
+    {200, 3, {'T', 'o', ' '}},
+    {795, 6, {'.'}},
+  };
+  unsigned int i;
+
+  for (i = 0; i < 800; i++)
+    codepoints[i] = words[i % strlen (words)];
+  hb_buffer_add_utf32 (text, codepoints, 800, 0, 800);
+  hb_buffer_guess_segment_properties (text);
+  hb_buffer_append (buffer, text, 0, -1);
+  hb_shape (font, buffer, NULL, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (edits); i++)
+  {
+    g_assert (hb_shape_edit (font, buffer, text,
+			     edits[i].offset, edits[i].removed_length,
+			     edits[i].inserted, -1,
+			     NULL, 0, NULL));
+
+    hb_buffer_clear_contents (expected);
+    hb_buffer_append (expected, text, 0, -1);
+    hb_shape (font, expected, NULL, 0);
+    g_assert_cmpuint (hb_buffer_diff (buffer, expected, (hb_codepoint_t) -1, 0), ==, HB_BUFFER_DIFF_FLAG_EQUAL);
+  }
+  g_assert_cmpuint (hb_buffer_get_length (text), ==, 796);
+
+  g_assert (!hb_shape_edit (font, buffer, text, 797, 0, NULL, 0, NULL, 0, NULL));
+  g_assert (!hb_shape_edit (font, buffer, text, 790, 8, NULL, 0, NULL, 0, NULL));
+  g_assert (!hb_shape_edit (font, buffer, text, 0, 0, edits[0].inserted, -2, NULL, 0, NULL));
+  g_assert_cmpuint (hb_buffer_get_length (text), ==, 796);
+
+  hb_buffer_destroy (text);
+  hb_buffer_destroy (buffer);
+  hb_buffer_destroy (expected);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -203,6 +798,19 @@ main (int argc, char **argv)
   /* TODO test fallback shaper */
   /* TODO test shaper_full */
   hb_test_add (test_shape_list);
+  hb_test_add (test_shape_plan_cache);
+  hb_test_add (test_shape_plan_derive);
+  hb_test_add (test_shape_flat_layout);
+  hb_test_add (test_shape_flat_layout_kern);
+  hb_test_add (test_shape_flat_layout_unsorted_pairs);
+  hb_test_add (test_shape_ligature_zwj_run);
+  hb_test_add (test_shape_var_deltas);
+  hb_test_add (test_shape_cache);
+  hb_test_add (test_shape_cache_evict);
+  hb_test_add (test_shape_cache_fallback);
+  hb_test_add (test_shape_parallel);
+  hb_test_add (test_shape_edit);
+  hb_test_add (test_shape_batch);
 
   return hb_test_run();
 }
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <thread>
 #include <condition_variable>
@@ -59,15 +60,16 @@ static bool ready = false;
 static unsigned num_repetitions = 1;
 static unsigned num_threads = 3;
 
-static void shape (const test_input_t &input,
-		   hb_font_t *font)
+static void wait_for_start ()
 {
   // Wait till all threads are ready.
-  {
-    std::unique_lock<std::mutex> lk (cv_m);
-    cv.wait(lk, [] {return ready;});
-  }
+  std::unique_lock<std::mutex> lk (cv_m);
+  cv.wait(lk, [] {return ready;});
+}
 
+static void shape (const test_input_t &input,
+		   hb_font_t *font)
+{
   const char *lang_str = strrchr (input.text_path, '/');
   lang_str = lang_str ? lang_str + 1 : input.text_path;
   hb_language_t language = hb_language_from_string (lang_str, -1);
@@ -103,34 +105,11 @@ static void shape (const test_input_t &input,
   hb_blob_destroy (text_blob);
 }
 
-static void test_backend (backend_t backend,
-			  const char *backend_name,
-			  bool variable,
-			  const test_input_t &test_input)
+static hb_font_t *create_font (hb_face_t *face,
+			       backend_t backend,
+			       bool variable)
 {
-  char name[1024] = "shape";
-  const char *p;
-  strcat (name, "/");
-  p = strrchr (test_input.font_path, '/');
-  strcat (name, p ? p + 1 : test_input.font_path);
-  strcat (name, "/");
-  p = strrchr (test_input.text_path, '/');
-  strcat (name, p ? p + 1 : test_input.text_path);
-  strcat (name, variable ? "/var" : "");
-  strcat (name, "/");
-  strcat (name, backend_name);
-
-  printf ("Testing %s\n", name);
-
-  hb_font_t *font;
-  {
-    hb_blob_t *blob = hb_blob_create_from_file_or_fail (test_input.font_path);
-    assert (blob);
-    hb_face_t *face = hb_face_create (blob, 0);
-    hb_blob_destroy (blob);
-    font = hb_font_create (face);
-    hb_face_destroy (face);
-  }
+  hb_font_t *font = hb_font_create (face);
 
   if (variable)
   {
@@ -151,9 +130,61 @@ static void test_backend (backend_t backend,
       break;
   }
 
+  return font;
+}
+
+/* Each thread sets up, and shapes with, a font of its own. */
+static void shape_own_font (const test_input_t &input,
+			    hb_face_t *face,
+			    backend_t backend,
+			    bool variable)
+{
+  wait_for_start ();
+
+  hb_font_t *font = create_font (face, backend, variable);
+  shape (input, font);
+  hb_font_destroy (font);
+}
+
+/* All threads shape with the same, frozen, font. */
+static void shape_shared_font (const test_input_t &input,
+			       hb_font_t *font)
+{
+  wait_for_start ();
+
+  shape (input, font);
+}
+
+/* Returns wall-clock time, in milliseconds, of shaping the input
+ * on @n threads, including any font setup. */
+static double run_threads (unsigned n,
+			   bool shared,
+			   backend_t backend,
+			   bool variable,
+			   const test_input_t &test_input,
+			   hb_blob_t *blob)
+{
+  hb_face_t *face = hb_face_create (blob, 0);
+
+  {
+    std::unique_lock<std::mutex> lk (cv_m);
+    ready = false;
+  }
+
+  auto start = std::chrono::steady_clock::now ();
+
+  hb_font_t *font = nullptr;
+  if (shared)
+  {
+    font = create_font (face, backend, variable);
+    hb_font_freeze (font);
+  }
+
   std::vector<std::thread> threads;
-  for (unsigned i = 0; i < num_threads; i++)
-    threads.push_back (std::thread (shape, test_input, font));
+  for (unsigned i = 0; i < n; i++)
+    threads.push_back (shared
+		       ? std::thread (shape_shared_font, test_input, font)
+		       : std::thread (shape_own_font, test_input, face, backend, variable));
 
   {
     std::unique_lock<std::mutex> lk (cv_m);
@@ -161,10 +192,64 @@ static void test_backend (backend_t backend,
   }
   cv.notify_all();
 
-  for (unsigned i = 0; i < num_threads; i++)
+  for (unsigned i = 0; i < n; i++)
     threads[i].join ();
 
+  auto end = std::chrono::steady_clock::now ();
+
   hb_font_destroy (font);
+  hb_face_destroy (face);
+
+  return std::chrono::duration<double, std::milli> (end - start).count ();
+}
+
+/* Scale from one thread up to num_threads, doubling in between. */
+static unsigned next_thread_count (unsigned n)
+{
+  return n < num_threads && n * 2 > num_threads ? num_threads : n * 2;
+}
+
+static void test_backend (backend_t backend,
+			  const char *backend_name,
+			  bool variable,
+			  const test_input_t &test_input)
+{
+  char name[1024] = "shape";
+  const char *p;
+  strcat (name, "/");
+  p = strrchr (test_input.font_path, '/');
+  strcat (name, p ? p + 1 : test_input.font_path);
+  strcat (name, "/");
+  p = strrchr (test_input.text_path, '/');
+  strcat (name, p ? p + 1 : test_input.text_path);
+  strcat (name, variable ? "/var" : "");
+  strcat (name, "/");
+  strcat (name, backend_name);
+
+  printf ("Testing %s\n", name);
+
+  hb_blob_t *blob = hb_blob_create_from_file_or_fail (test_input.font_path);
+  assert (blob);
+
+  double own_base = 0, shared_base = 0;
+  for (unsigned n = 1; n <= num_threads; n = next_thread_count (n))
+  {
+    double own = run_threads (n, false, backend, variable, test_input, blob);
+    double shared = run_threads (n, true, backend, variable, test_input, blob);
+    if (n == 1)
+    {
+      own_base = own;
+      shared_base = shared;
+    }
+
+    /* Speedup is relative to a single thread doing the same total work. */
+    printf ("  threads %3u  own fonts %9.2fms (%5.2fx)  shared frozen font %9.2fms (%5.2fx)\n",
+	    n,
+	    own, own_base * n / own,
+	    shared, shared_base * n / shared);
+  }
+
+  hb_blob_destroy (blob);
 }
 
 int main(int argc, char** argv)